@@ -10,7 +10,16 @@
  * 1. Choose a video containing ArUco markers
  * 2. Use << MarkersDetector >> on the chosen video
  * 3. Use << MarkerDataFilter >> on the output YAML files of << MarkersDetector >> 
- * 4. Use << CameraMotion >> with the output YAML files of << MarkerDataFilter >>
+ * 4. Use << CameraMotion >> with the output track of << MarkerDataFilter >>
+ * 
+ * The centers and the ground truth are read from the binary tracks "_markers_centers.mkt" and
+ * "camera_translation_data.mkt" when they exist (<< trackConverter >> of CompleteOpticalFlow),
+ * from the YAML files otherwise. With HAS_CORNERS the corners are read from the track
+ * "filtered_markers.mkt" of << MarkerDataFilter >>
+ * 
+ * Benchmark mode : << CameraMotion --benchmark [max frames] [RMS budget] [output CSV] >>
+ * runs every combination of detector, BEST_POINTS, PERCENT and refresh mode against the
+ * ground truth of << CameraMotionGT >> and prints the accuracy-vs-speed Pareto table
  * 
  * 
  * Note:
@@ -24,6 +33,10 @@
 // Standard libraries
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
 #include <math.h>
 
 // OpenCV libraries
@@ -35,7 +48,8 @@
 
 // Others
 #include "OutputControl.h"
-#include "TicToc.h"
+#include "Profiler.h"
+#include "MarkerTrack.h"
 
 // Namespaces
 using namespace cv;
@@ -51,6 +65,13 @@ float const PERCENT = 0.86;
 bool const REFRESH_MODE_ALL = 1;
 bool const HAS_CORNERS = 0;
 
+// Benchmark parametres, every combination is run on the same frames
+string const SWEEP_DETECTORS[] = {"FAST", "ORB", "BRISK", "HARRIS", "STAR", "SIFT", "SURF", "MSER"};
+int const SWEEP_BEST_POINTS[] = {100, 200, 400};
+float const SWEEP_PERCENT[] = {0.7, 0.86, 0.95};
+bool const SWEEP_REFRESH_MODE_ALL[] = {1, 0};
+int const DEFAULT_BENCHMARK_FRAMES = 300;
+
 
 //////////////////////////////////////
 // Create red arrows on the frames	
@@ -256,11 +277,310 @@ float rmsError(Mat coordinate1 , Mat coordinate2)
 
 
 
+//////////////////////////////////////////////////////////////////////
+// The ground truth holds either the translation or the homography
+//////////////////////////////////////////////////////////////////////
+Mat groundTruthTranslation(Mat backGT)
+{
+	if (backGT.rows == 3 && backGT.cols == 3)
+		return (Mat_<float> (1,2) << backGT.at<double>(0,2), backGT.at<double>(1,2));
+	
+	Mat translation;
+	backGT.convertTo(translation, CV_32F);
+	return translation;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+// Per frame data : the memory-mapped track "name.mkt" when it exists, "name.yml" otherwise.
+// The matrices of the track are read-only views valid as long as the FrameData
+//////////////////////////////////////////////////////////////////////////////////////
+struct FrameData
+{
+	MarkerTrackMapping track;
+	FileStorage file;
+	
+	bool open(string name)
+	{
+		if (track.open(name + ".mkt"))
+			return true;
+		return file.open(name + ".yml", FileStorage::READ);
+	}
+	
+	bool isOpened()
+	{
+		return track.isOpened() || file.isOpened();
+	}
+	
+	int frameCount()
+	{
+		return track.isOpened() ? track.getFrameCount() : (int) file["frameCount"];
+	}
+	
+	Mat frame(int frame)
+	{
+		if (track.isOpened())
+			return track.getCenters(frame);
+		
+		Mat matrix;
+		stringstream frameNumber;
+		frameNumber << "frame" << frame;
+		file[frameNumber.str()] >> matrix;
+		return matrix;
+	}
+	
+	// Only the binary tracks hold the corners, and only when they were written with them
+	bool hasCorners()
+	{
+		return track.isOpened() && track.hasCorners();
+	}
+	
+	Mat corners(int frame)
+	{
+		if (track.isOpened())
+			return track.getCorners(frame);
+		return Mat();
+	}
+	
+	// The ground truth tracks hold a single marker whose missing flag is set when the frame has
+	// no ground truth, its coordinates can be negative so they do not tell it
+	bool hasGroundTruth(int frame)
+	{
+		if (track.isOpened())
+			return !track.isMissing(frame, 0);
+		return !this->frame(frame).empty();
+	}
+	
+	void release()
+	{
+		track.close();
+		file.release();
+	}
+};
+
+
+///////////////////////////////////////////////
+// One configuration of the benchmark sweep
+///////////////////////////////////////////////
+struct motionConfig
+{
+	string detectorName;
+	int bestPoints;
+	float percent;
+	bool refreshModeAll;
+	
+	// Results
+	double meanError;
+	double maxError;
+	double msPerFrame;
+	int frames;
+	int failures;
+	int refreshes;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Same processing as the main loop, without display, on frames already in memory
+// Only the processing of the frames is timed, not the reading of the files
+/////////////////////////////////////////////////////////////////////////////////////
+void runConfig(motionConfig &config, const vector<Mat> &frames, const vector<Mat> &centers, const vector<Mat> &groundTruth)
+{
+	Ptr<FeatureDetector> detector;
+	initFeatureDetector(detector , config.detectorName);
+	
+	vector<KeyPoint> keypoints;
+	vector<Point2f> kpt1,kpt2,kpt_tmp;
+	vector<uchar> status;
+	vector<float> err;
+	Mat foundHomography, hStatus;
+	Mat mask(frames.front().rows, frames.front().cols, CV_8UC1);
+	
+	double errorSum = 0;
+	config.maxError = 0;
+	config.frames = 0;
+	config.failures = 0;
+	config.refreshes = 0;
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	mask.setTo(Scalar::all(225));
+	maskUpdate(centers.front(), mask, CORNER_BACK);
+	detector->detect(frames.front(), keypoints, mask);
+	KeyPointsFilter::retainBest(keypoints, config.bestPoints);
+	KeyPoint::convert(keypoints, kpt1);
+	
+	for(int i = 1; i < frames.size(); ++i)
+	{
+		mask.setTo(Scalar::all(225));
+		maskUpdate(centers.at(i), mask, CORNER_BACK);
+		
+		detector->detect(frames.at(i), keypoints, mask);
+		KeyPointsFilter::retainBest(keypoints, config.bestPoints);
+		KeyPoint::convert(keypoints, kpt2);
+		kpt_tmp = kpt2;
+		
+		if (kpt1.empty())
+		{
+			kpt1 = kpt_tmp;
+			config.failures++;
+			continue;
+		}
+		
+		calcOpticalFlowPyrLK(frames.at(i-1), frames.at(i), kpt1, kpt2, status, err);
+		kpt1 = cleanFeatures(kpt1, status);
+		kpt2 = cleanFeatures(kpt2, status);
+		
+		if (kpt1.size() < 4 || (foundHomography = findHomography(kpt1,kpt2,CV_RANSAC,3,hStatus)).empty())
+			config.failures++;
+		
+		else if (!groundTruth.at(i).empty())
+		{
+			float absError = rmsError(groundTruth.at(i), (Mat_<float> (1,2) << foundHomography.at<double>(0,2), foundHomography.at<double>(1,2)));
+			errorSum += absError;
+			config.maxError = max(config.maxError, (double) absError);
+			config.frames++;
+		}
+		
+		if( (float) kpt2.size()/config.bestPoints < config.percent)
+		{
+			if (config.refreshModeAll)
+				kpt1 = kpt_tmp;
+			
+			else
+			{
+				kpt1 = kpt2;
+				detector->detect(frames.at(i), keypoints, mask);
+				KeyPointsFilter::retainBest(keypoints, (int) config.bestPoints*(1-config.percent));
+				KeyPoint::convert(keypoints, kpt_tmp);
+				kpt1.insert(kpt1.end(), kpt_tmp.begin(), kpt_tmp.end());
+			}
+			config.refreshes++;
+		}
+		else
+			kpt1 = kpt2;
+	}
+	
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	config.msPerFrame = chrono::duration<double, milli>(end - start).count()/frames.size();
+	config.meanError = (config.frames > 0) ? errorSum/config.frames : -1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+// Sweep the detector, BEST_POINTS, PERCENT and the refresh mode, then print the
+// configurations from the fastest to the slowest with their Pareto front
+// (no faster configuration is as accurate) and write everything in a CSV file
+//////////////////////////////////////////////////////////////////////////////////////
+int benchmark(int maxFrames, double errorBudget, string output)
+{
+	VideoCapture capture("marker_video_2.mp4");
+	FrameData markersCenter, backgroundGT;
+	markersCenter.open("_markers_centers");
+	backgroundGT.open("camera_translation_data");
+	if (!capture.isOpened() || ! markersCenter.isOpened() || ! backgroundGT.isOpened())
+	{
+		cerr <<"Error opening the video or the data files !" <<endl;
+		return -1;
+	}
+	
+	// Load everything once, the configurations all run on the same data
+	vector<Mat> frames, centers, groundTruth;
+	int frameCount = min(markersCenter.frameCount(), maxFrames);
+	for(int frame = 1; frame <= frameCount; frame++ )
+	{
+		Mat image;
+		capture >> image;
+		if (image.empty())
+			break;
+		
+		Mat centersMatrix = markersCenter.frame(frame);
+		
+		frames.push_back(image);
+		centers.push_back(centersMatrix);
+		groundTruth.push_back(backgroundGT.hasGroundTruth(frame) ? groundTruthTranslation(backgroundGT.frame(frame)) : Mat());
+	}
+	
+	if (frames.size() < 2)
+	{
+		cerr << "Not enough frames for the benchmark !" << endl;
+		return -1;
+	}
+	cout << "Benchmark on " << frames.size() << " frames" << endl;
+	
+	vector<motionConfig> configs;
+	for(int d = 0; d < sizeof(SWEEP_DETECTORS)/sizeof(SWEEP_DETECTORS[0]); ++d)
+		for(int b = 0; b < sizeof(SWEEP_BEST_POINTS)/sizeof(SWEEP_BEST_POINTS[0]); ++b)
+			for(int p = 0; p < sizeof(SWEEP_PERCENT)/sizeof(SWEEP_PERCENT[0]); ++p)
+				for(int r = 0; r < sizeof(SWEEP_REFRESH_MODE_ALL)/sizeof(SWEEP_REFRESH_MODE_ALL[0]); ++r)
+				{
+					motionConfig config;
+					config.detectorName = SWEEP_DETECTORS[d];
+					config.bestPoints = SWEEP_BEST_POINTS[b];
+					config.percent = SWEEP_PERCENT[p];
+					config.refreshModeAll = SWEEP_REFRESH_MODE_ALL[r];
+					runConfig(config, frames, centers, groundTruth);
+					configs.push_back(config);
+					
+					cout << config.detectorName << " " << config.bestPoints << " " << config.percent << " " << (config.refreshModeAll ? "all" : "partial")
+						 << " -- " << config.msPerFrame << " ms/frame -- RMS mean " << config.meanError << " max " << config.maxError << endl;
+				}
+	
+	// Pareto front : going from the fastest to the slowest, keep the ones that improve the mean error
+	sort(configs.begin(), configs.end(), [](const motionConfig &a, const motionConfig &b) { return a.msPerFrame < b.msPerFrame; });
+	
+	ofstream file(output.c_str());
+	file << "detector,best_points,percent,refresh_all,ms_per_frame,mean_rms,max_rms,frames,failures,refreshes,pareto" << endl;
+	
+	cout << endl << "Pareto table (fastest first)" << endl;
+	cout << "detector\tpoints\tpercent\trefresh\tms/frame\tmean RMS\tmax RMS" << endl;
+	
+	double bestError = -1;
+	int chosen = -1;
+	for(int i = 0; i < configs.size(); ++i)
+	{
+		const motionConfig &c = configs.at(i);
+		bool pareto = c.meanError >= 0 && (bestError < 0 || c.meanError < bestError);
+		if (pareto)
+		{
+			bestError = c.meanError;
+			cout << c.detectorName << "\t" << c.bestPoints << "\t" << c.percent << "\t" << (c.refreshModeAll ? "all" : "partial") << "\t"
+				 << c.msPerFrame << "\t" << c.meanError << "\t" << c.maxError << endl;
+		}
+		if (chosen < 0 && c.meanError >= 0 && c.meanError <= errorBudget)
+			chosen = i;
+		
+		file << c.detectorName << "," << c.bestPoints << "," << c.percent << "," << c.refreshModeAll << ","
+			 << c.msPerFrame << "," << c.meanError << "," << c.maxError << ","
+			 << c.frames << "," << c.failures << "," << c.refreshes << "," << pareto << endl;
+	}
+	
+	if (errorBudget > 0)
+	{
+		if (chosen < 0)
+			cout << endl << "No configuration has a mean RMS error under " << errorBudget << endl;
+		else
+			cout << endl << "Fastest configuration with a mean RMS error under " << errorBudget << " : "
+				 << configs.at(chosen).detectorName << " " << configs.at(chosen).bestPoints << " " << configs.at(chosen).percent << " "
+				 << (configs.at(chosen).refreshModeAll ? "all" : "partial") << " (" << configs.at(chosen).msPerFrame << " ms/frame)" << endl;
+	}
+	cout << "Results written in " << output << endl;
+	
+	return 0;
+}
+
+
+
 ////////////////////
 // Main function
 ///////////////////
 int main(int argc, char **argv) 
 {
+	// ./CameraMotion --benchmark [max frames] [RMS budget] [output CSV]
+	if (argc > 1 && string(argv[1]) == "--benchmark")
+		return benchmark((argc > 2) ? atoi(argv[2]) : DEFAULT_BENCHMARK_FRAMES,
+						 (argc > 3) ? atof(argv[3]) : -1,
+						 (argc > 4) ? argv[4] : "camera_motion_benchmark.csv");
+	
 	// Open the video file
 	VideoCapture capture("marker_video_2.mp4");
 	
@@ -276,12 +596,12 @@ int main(int argc, char **argv)
     
 	
     // Open the datafiles
-	FileStorage markersCenter("_markers_centers.yml", FileStorage::READ);
-	FileStorage markersCorners,backgroundGT,foregroundGT;
+	FrameData markersCenter, markersCorners, backgroundGT, foregroundGT;
+	markersCenter.open("_markers_centers");
 	if (HAS_CORNERS)
 	{
-		markersCorners.open("filtered_markers_corners.yml", FileStorage::READ);
-		if(! markersCenter.isOpened() ||! markersCorners.isOpened())
+		markersCorners.open("filtered_markers");
+		if(! markersCenter.isOpened() ||! markersCorners.hasCorners())
 		{
 			cerr <<"Error opening data files !" <<endl;
 			return -1;
@@ -290,8 +610,8 @@ int main(int argc, char **argv)
 	
 	else
 	{
-		backgroundGT.open("camera_translation_data.yml", FileStorage::READ);
-		foregroundGT.open("foreground_translation_data.yml", FileStorage::READ);
+		backgroundGT.open("camera_translation_data");
+		foregroundGT.open("foreground_translation_data");
 		
 		if(! markersCenter.isOpened() || ! backgroundGT.isOpened() || ! foregroundGT.isOpened())
 		{
@@ -312,11 +632,11 @@ int main(int argc, char **argv)
 	Mat frame1, frame2;
 	Mat foundHomography, perspectiveIm, hStatus;
 	OutputControl option;
-	TicToc time;
+	int frameStage = Profiler::stage("frame");
 	
 	Mat centersMatrix, cornersMatrix;
-	markersCenter ["frame1"] >> centersMatrix;
-	markersCorners ["frame1"] >> cornersMatrix;
+	centersMatrix = markersCenter.frame(1);
+	cornersMatrix = markersCorners.corners(1);
 	
 	// Mask creation
 	Mat mask(capture.get(CV_CAP_PROP_FRAME_HEIGHT),capture.get(CV_CAP_PROP_FRAME_WIDTH), CV_8UC1,Scalar::all(225));
@@ -331,55 +651,76 @@ int main(int argc, char **argv)
 	KeyPointsFilter::retainBest(keypoints,BEST_POINTS);
 	KeyPoint::convert(keypoints, kpt1);
 	
-	stringstream frameNumber;
-	int frameCount = (int)  markersCenter["frameCount"];
+	int frameCount = markersCenter.frameCount();
+	double errorSum = 0;
+	float maxError = 0;
+	int errorCount = 0;
 
 	for(int frame = 2; frame <= frameCount; frame++ )
 	{
-	//	time.tic();
+		ScopedZone frameZone(frameStage);
+		
 		// Acquire new frame
-		capture >> frame2;
+		{
+			ScopedZone zone(STAGE_CAPTURE);
+			capture >> frame2;
+		}
 		
 		// End when video finishes
 		if (frame2.empty() )
 			break;
 		
 		// Retrive information about the center and the corners of the markers
-		frameNumber.str("");
-		frameNumber << "frame" << frame;
-		markersCenter [frameNumber.str()] >> centersMatrix;
-		markersCorners [frameNumber.str()] >> cornersMatrix;
+		centersMatrix = markersCenter.frame(frame);
+		cornersMatrix = markersCorners.corners(frame);
 		
 		
 		// Mask update
-		mask = Mat(capture.get(CV_CAP_PROP_FRAME_HEIGHT),capture.get(CV_CAP_PROP_FRAME_WIDTH), CV_8UC1,Scalar::all(225));
-		if(HAS_CORNERS)
-			maskUpdate(cornersMatrix,mask);
-		else
-			maskUpdate(centersMatrix,mask, CORNER_BACK);
+		{
+			ScopedZone zone(STAGE_MASK);
+			mask = Mat(capture.get(CV_CAP_PROP_FRAME_HEIGHT),capture.get(CV_CAP_PROP_FRAME_WIDTH), CV_8UC1,Scalar::all(225));
+			if(HAS_CORNERS)
+				maskUpdate(cornersMatrix,mask);
+			else
+				maskUpdate(centersMatrix,mask, CORNER_BACK);
+		}
 		
 		// Detecting keypoints
-		detector->detect(frame2, keypoints,mask);
-		KeyPointsFilter::retainBest(keypoints,BEST_POINTS);
-		KeyPoint::convert(keypoints, kpt2);
-		kpt_tmp = kpt2;
+		{
+			ScopedZone zone(STAGE_DETECT);
+			detector->detect(frame2, keypoints,mask);
+			KeyPointsFilter::retainBest(keypoints,BEST_POINTS);
+			KeyPoint::convert(keypoints, kpt2);
+			kpt_tmp = kpt2;
+		}
 		
 		// Compute opticalflow
-		calcOpticalFlowPyrLK(frame1,frame2,kpt1,kpt2,status,err);
-		
-		// Keep only the feature with status == 1
-		kpt1 = cleanFeatures(kpt1,status);
-		kpt2 = cleanFeatures(kpt2, status);
+		{
+			ScopedZone zone(STAGE_LK);
+			calcOpticalFlowPyrLK(frame1,frame2,kpt1,kpt2,status,err);
+			
+			// Keep only the feature with status == 1
+			kpt1 = cleanFeatures(kpt1,status);
+			kpt2 = cleanFeatures(kpt2, status);
+		}
 		
 		//Find Homography
-		foundHomography = findHomography(kpt1,kpt2,CV_RANSAC,3,hStatus);
+		{
+			ScopedZone zone(STAGE_RANSAC);
+			foundHomography = findHomography(kpt1,kpt2,CV_RANSAC,3,hStatus);
+		}
 // 		cout << foundHomography << endl;
 		
-		Mat backGT;
-		backgroundGT[frameNumber.str()] >> backGT;
-		
-		float absError = rmsError(backGT,  (Mat_<float> (1,2) << foundHomography.at<double>(0,2), foundHomography.at<double>(1,2)));
-		cout << absError <<endl;
+		// Frames without ground truth are not in the error
+		if (backgroundGT.hasGroundTruth(frame) && !foundHomography.empty())
+		{
+			Mat backGT = backgroundGT.frame(frame);
+			float absError = rmsError(groundTruthTranslation(backGT),  (Mat_<float> (1,2) << foundHomography.at<double>(0,2), foundHomography.at<double>(1,2)));
+			cout << absError <<endl;
+			errorSum += absError;
+			maxError = max(maxError, absError);
+			errorCount++;
+		}
 // 		//Create the perspective image
 // 		warpPerspective(frame2,perspectiveIm,foundHomography,frame2.size(), CV_INTER_LINEAR | CV_WARP_INVERSE_MAP);
 // 		namedWindow("Perspective Image",0);
@@ -390,32 +731,38 @@ int main(int argc, char **argv)
 		
 		// Fancy output view
 		// Draw the center of the mask and the arrows of the flow vthen show the video
-		drawDots(centersMatrix, frame2);
-		opticalflowArrows (frame2, hStatus, kpt1, kpt2);
-		namedWindow("opticalflow Image",0);
-		resizeWindow("opticalflow Image", 600,380);
-		imshow("opticalflow Image", frame2);
+		{
+			ScopedZone zone(STAGE_OUTPUT);
+			drawDots(centersMatrix, frame2);
+			opticalflowArrows (frame2, hStatus, kpt1, kpt2);
+			namedWindow("opticalflow Image",0);
+			resizeWindow("opticalflow Image", 600,380);
+			imshow("opticalflow Image", frame2);
+		}
 		
 		// If the percentage of correspondance drops under 85% refresh the features tracked
 		//cout << (float) kpt2.size()/BEST_POINTS <<endl;
-		if( (float) kpt2.size()/BEST_POINTS < PERCENT)
 		{
-			if (REFRESH_MODE_ALL)
-				kpt1 = kpt_tmp;
-			
-			else
+			ScopedZone zone(STAGE_TRACKING);
+			if( (float) kpt2.size()/BEST_POINTS < PERCENT)
 			{
-				kpt1 = kpt2;
-				detector->detect(frame2, keypoints,mask);
-				KeyPointsFilter::retainBest(keypoints,(int) BEST_POINTS*(1-PERCENT));
-				KeyPoint::convert(keypoints, kpt_tmp);
-				kpt1.insert(kpt1.end(),kpt_tmp.begin(),kpt_tmp.end());
+				if (REFRESH_MODE_ALL)
+					kpt1 = kpt_tmp;
+				
+				else
+				{
+					kpt1 = kpt2;
+					detector->detect(frame2, keypoints,mask);
+					KeyPointsFilter::retainBest(keypoints,(int) BEST_POINTS*(1-PERCENT));
+					KeyPoint::convert(keypoints, kpt_tmp);
+					kpt1.insert(kpt1.end(),kpt_tmp.begin(),kpt_tmp.end());
+				}
+				
+				cout<< "REFRESH ! " << endl;
 			}
-			
-			cout<< "REFRESH ! " << endl;
+			else
+				kpt1 = kpt2;
 		}
-		else
-			kpt1 = kpt2;
 		
 		// Program control
 		char c = waitKey(1000/fps);
@@ -423,13 +770,19 @@ int main(int argc, char **argv)
 			break;
 		option.pauseProgram(c);
 		option.screenshot(c, frame2);
-//		cout << (double) mask.rows*mask.cols/time.getToc() << " pixels/second" << endl;
-// 		time.toc();
 	}
 	
+	Profiler::summary();
+	if (Profiler::totalTime(frameStage) > 0)
+		cout << (double) mask.rows*mask.cols*Profiler::count(frameStage)/Profiler::totalTime(frameStage) << " pixels/second" << endl;
+	
+	if (errorCount > 0)
+		cout << "RMS error -- Mean : " << errorSum/errorCount << " -- Max : " << maxError << endl;
+	
 	// close the data files
 	markersCenter.release();
 	markersCorners.release();
+	backgroundGT.release();
 	
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstddef>
+#include <utility>
+
+
+// Bounded lock-free queue with a single producer and a single consumer.
+// One slot is always left empty to distinguish a full ring from an empty one.
+// The items are moved in and out, so the buffers of a vector travel with it without any copy.
+template <typename T>
+class boundedQueue
+{
+private:
+	std::vector<T> buffer;
+	std::size_t capacity;
+
+	// head is only written by the consumer, tail only by the producer
+	std::atomic<std::size_t> head;
+	std::atomic<std::size_t> tail;
+
+	std::size_t next(std::size_t index) const
+	{
+		return (index+1 == capacity) ? 0 : index+1;
+	}
+
+public:
+	explicit boundedQueue(std::size_t size = 8) : buffer(size+1), capacity(size+1), head(0), tail(0) {}
+
+	bool tryPush(T &item)
+	{
+		std::size_t currentTail = tail.load(std::memory_order_relaxed);
+		std::size_t nextTail = next(currentTail);
+		if (nextTail == head.load(std::memory_order_acquire))
+			return false;
+
+		buffer[currentTail] = std::move(item);
+		tail.store(nextTail, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop(T &item)
+	{
+		std::size_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire))
+			return false;
+
+		item = std::move(buffer[currentHead]);
+		// Release the slot so that the references it holds (cv::Mat buffers) are dropped
+		buffer[currentHead] = T();
+		head.store(next(currentHead), std::memory_order_release);
+		return true;
+	}
+
+	// Blocking versions, give up when abort becomes true
+	bool push(T &item, const std::atomic<bool> &abort)
+	{
+		while (!tryPush(item))
+		{
+			if (abort.load(std::memory_order_relaxed))
+				return false;
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	bool pop(T &item, const std::atomic<bool> &abort)
+	{
+		while (!tryPop(item))
+		{
+			if (abort.load(std::memory_order_relaxed))
+				return false;
+			std::this_thread::yield();
+		}
+		return true;
+	}
+};
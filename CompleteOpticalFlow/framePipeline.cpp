@@ -0,0 +1,241 @@
+// Standard libraries
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+// Header
+#include "framePipeline.h"
+#include "profiler.h"
+
+
+// Constructor
+framePipeline::framePipeline(cv::VideoCapture &capture, markersDetector &markers, cv::FileStorage &centers, opticalFlow &flow, int queueSize)
+	: capture(capture), markers(markers), centers(centers), track(NULL), flow(flow),
+	  decoded(queueSize), masked(queueSize), tracked(queueSize), estimated(queueSize),
+	  recycled(4*queueSize+4), abort(false)
+{
+	width = capture.get(CV_CAP_PROP_FRAME_WIDTH);
+	height = capture.get(CV_CAP_PROP_FRAME_HEIGHT);
+	
+	// Each mask has its own buffer
+	masks.reserve(queueSize+3);
+	for (int i = 0; i < queueSize+3; ++i)
+		masks.push_back(markersMask(height, width, flow.getCornerBackgroundSize()));
+	nextMask = 0;
+}
+
+framePipeline::~framePipeline()
+{
+	stop();
+}
+
+
+// Read the markers from a mapped binary track instead of the yml file, to be called before start()
+void framePipeline::setMarkersTrack(markerTrackMapping *track)
+{
+	this->track = track;
+}
+
+
+// Launch one thread per stage
+void framePipeline::start()
+{
+	abort = false;
+	stages.push_back(std::thread(&framePipeline::decodeStage, this));
+	stages.push_back(std::thread(&framePipeline::maskStage, this));
+	stages.push_back(std::thread(&framePipeline::trackStage, this));
+	stages.push_back(std::thread(&framePipeline::homographyStage, this));
+}
+
+
+// Output stage : wait for the next processed frame, false at the end of the video
+bool framePipeline::nextFrame(framePacket &packet)
+{
+	// The points of the previous frame are not used anymore, their buffers go back to the track stage.
+	// When the ring is full they are freed, the track stage then allocates new ones.
+	if (packet.kptPrev.capacity() > 0)
+	{
+		framePacket spent;
+		spent.kptPrev.swap(packet.kptPrev);
+		spent.kptNext.swap(packet.kptNext);
+		spent.err.swap(packet.err);
+		recycled.tryPush(spent);
+	}
+
+	if (!estimated.pop(packet, abort))
+		return false;
+	return !packet.last;
+}
+
+
+// Stop all the stages even if some frames are still in the queues
+void framePipeline::stop()
+{
+	abort = true;
+	for (int i = 0; i < stages.size(); ++i)
+		if (stages.at(i).joinable())
+			stages.at(i).join();
+	stages.clear();
+}
+
+
+// Acquire the frames and convert them to grayscale
+void framePipeline::decodeStage()
+{
+	traceRecorder::setThreadName("decode");
+	int frameNumber = 0;
+	while (true)
+	{
+		framePacket packet;
+		packet.frameNumber = ++frameNumber;
+		traceRecorder::setFrame(packet.frameNumber);
+		{
+			scopedZone zone(STAGE_CAPTURE);
+			capture >> packet.frame;
+		}
+
+		// End when video finishes
+		if (packet.frame.empty())
+		{
+			packet.last = true;
+			decoded.push(packet, abort);
+			return;
+		}
+
+		{
+			scopedZone zone(STAGE_GRAY);
+			cv::cvtColor(packet.frame, packet.frameGray, CV_BGR2GRAY);
+		}
+
+		if (!decoded.push(packet, abort))
+			return;
+	}
+}
+
+
+// Read the markers of the frame and build the mask that hides them
+void framePipeline::maskStage()
+{
+	traceRecorder::setThreadName("mask");
+	framePacket packet;
+	while (decoded.pop(packet, abort))
+	{
+		if (packet.last)
+		{
+			masked.push(packet, abort);
+			return;
+		}
+		traceRecorder::setFrame(packet.frameNumber);
+
+		{
+			scopedZone zone(STAGE_MASK);
+			
+			// The mapped track gives a view of the frame without any copy
+			if (track != NULL)
+				packet.centersMatrix = track->getCenters(packet.frameNumber);
+			else
+			{
+				if (packet.frameNumber > 1)
+					markers.newFrame();
+				markers.readMarkersFiles(centers);
+				markers.getCentersMatrix().copyTo(packet.centersMatrix);
+			}
+
+			// Only the boxes of the markers that moved since this mask was last used are redrawn
+			packet.mask = masks.at(nextMask).update(packet.centersMatrix);
+			nextMask = (nextMask+1) % masks.size();
+		}
+
+		if (!masked.push(packet, abort))
+			return;
+	}
+}
+
+
+// Detect the features and track them with the optical flow
+void framePipeline::trackStage()
+{
+	traceRecorder::setThreadName("track");
+	int refreshStage = profiler::stage("keypoints refresh");
+	framePacket packet;
+	cv::Mat framePrev;
+	while (masked.pop(packet, abort))
+	{
+		if (packet.last)
+		{
+			tracked.push(packet, abort);
+			return;
+		}
+		traceRecorder::setFrame(packet.frameNumber);
+
+		{
+			scopedZone zone(STAGE_DETECT);
+			flow.FeatureDetection(packet.frameGray, packet.mask);
+			traceRecorder::setKeypoints(flow.getKeypointsCount());
+		}
+
+		// The first frame only initializes the features
+		if (framePrev.empty())
+		{
+			framePrev = packet.frameGray;
+			packet.mask = cv::Mat();
+			continue;
+		}
+
+		{
+			scopedZone zone(STAGE_LK);
+			flow.trackFeatures(framePrev, packet.frameGray);
+			
+			// Once every packet in flight has been through the output, the buffers are
+			// only recycled and the copy of the points does not allocate
+			framePacket spent;
+			if (recycled.tryPop(spent))
+			{
+				packet.kptPrev.swap(spent.kptPrev);
+				packet.kptNext.swap(spent.kptNext);
+				packet.err.swap(spent.err);
+			}
+			flow.getMatchedPoints(packet.kptPrev, packet.kptNext, packet.err);
+			traceRecorder::setKeypoints(packet.kptNext.size());
+		}
+		{
+			scopedZone zone(refreshStage);
+			flow.keyPointsUpdate(packet.frameGray, packet.mask);
+		}
+		
+		// Give the mask back to the mask stage
+		packet.mask = cv::Mat();
+
+		// The decode stage gives a new buffer for each frame, no copy is needed
+		framePrev = packet.frameGray;
+
+		if (!tracked.push(packet, abort))
+			return;
+	}
+}
+
+
+// Find the homography between the matched features
+void framePipeline::homographyStage()
+{
+	traceRecorder::setThreadName("homography");
+	framePacket packet;
+	while (tracked.pop(packet, abort))
+	{
+		if (!packet.last)
+		{
+			traceRecorder::setFrame(packet.frameNumber);
+			traceRecorder::setKeypoints(packet.kptNext.size());
+			scopedZone zone(STAGE_RANSAC);
+			estimator.estimate(packet.kptPrev,packet.kptNext,packet.err,packet.homography,packet.hStatus);
+		}
+
+		if (!estimated.push(packet, abort) || packet.last)
+			return;
+	}
+}
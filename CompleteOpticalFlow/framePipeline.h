@@ -0,0 +1,90 @@
+#pragma once
+
+// Standard libraries
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+// Others
+#include "boundedQueue.h"
+#include "markersDetector.h"
+#include "opticalFlow.h"
+#include "markersMask.h"
+#include "homographyEstimator.h"
+#include "markerTrack.h"
+
+
+// Everything that travels from one stage of the pipeline to the next
+struct framePacket
+{
+	int frameNumber;
+	bool last;
+
+	cv::Mat frame;
+	cv::Mat frameGray;
+	cv::Mat mask;
+	cv::Mat centersMatrix;
+
+	std::vector<cv::Point2f> kptPrev, kptNext;
+	std::vector<float> err;
+	cv::Mat homography;
+	cv::Mat hStatus;
+
+	framePacket() : frameNumber(0), last(false) {}
+};
+
+
+// decode -> grayscale/mask -> detect+flow -> homography -> output
+// Each stage runs on its own thread and they are linked by bounded lock-free queues.
+// Every queue has a single producer and a single consumer so the frames are delivered in order.
+// The output stage is the caller of nextFrame(), so that highgui stays on the main thread.
+class framePipeline
+{
+private:
+	cv::VideoCapture &capture;
+	markersDetector &markers;
+	cv::FileStorage &centers;
+	markerTrackMapping *track;
+	opticalFlow &flow;
+	int width;
+	int height;
+
+	boundedQueue<framePacket> decoded;
+	boundedQueue<framePacket> masked;
+	boundedQueue<framePacket> tracked;
+	boundedQueue<framePacket> estimated;
+
+	// Point buffers of the frames already given to the output, sent back to the track stage
+	// so that the matched points are copied into buffers that already have their capacity
+	boundedQueue<framePacket> recycled;
+
+	// Masks are reused from frame to frame, there are enough of them to cover
+	// every frame that can be waiting in the masked queue or being processed
+	std::vector<markersMask> masks;
+	int nextMask;
+
+	// Only used by the homography stage
+	homographyEstimator estimator;
+
+	std::atomic<bool> abort;
+	std::vector<std::thread> stages;
+
+	void decodeStage();
+	void maskStage();
+	void trackStage();
+	void homographyStage();
+
+public:
+	framePipeline(cv::VideoCapture &capture, markersDetector &markers, cv::FileStorage &centers, opticalFlow &flow, int queueSize = 4);
+	~framePipeline();
+
+	void setMarkersTrack(markerTrackMapping *track);
+	void start();
+	bool nextFrame(framePacket &packet);
+	void stop();
+};
@@ -0,0 +1,314 @@
+// Standard libraries
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+// Header
+#include "homographyEstimator.h"
+
+// Global variables
+int const SAMPLE_SIZE = 4;
+
+
+// Number of iterations needed to draw an all inlier sample with the wanted confidence
+int neededIterations(double inlierRatio, double confidence, int maxIterations)
+{
+	double p = std::pow(inlierRatio, SAMPLE_SIZE);
+	if (p >= 1.)
+		return 0;
+	if (p <= 0.)
+		return maxIterations;
+	double needed = std::ceil(std::log(1.-confidence)/std::log(1.-p));
+	return (needed < maxIterations) ? (int) needed : maxIterations;
+}
+
+
+// True if three of the four points are (almost) on the same line
+bool degenerateSample(const cv::Point2d p[4])
+{
+	int triplets[4][3] = {{0,1,2}, {0,1,3}, {0,2,3}, {1,2,3}};
+	for(int i=0; i<4; ++i)
+	{
+		cv::Point2d a = p[triplets[i][1]] - p[triplets[i][0]];
+		cv::Point2d b = p[triplets[i][2]] - p[triplets[i][0]];
+		if (std::abs(a.x*b.y - a.y*b.x) < 1e-3)
+			return true;
+	}
+	return false;
+}
+
+
+// Constructor
+homographyEstimator::homographyEstimator(double threshold, int maxIterations, double confidence)
+{
+	this->threshold = threshold;
+	this->maxIterations = maxIterations;
+	this->confidence = confidence;
+	rng = cv::RNG(0xffffffff);
+
+	temporalPrior = true;
+	priorInlierRatio = 0.8;
+	history = 0;
+}
+
+
+// Successive frames of a video have almost the same homography : when the previous one (constant
+// velocity, the homographies are already frame-to-frame motions) or its constant acceleration
+// extrapolation still has priorInlierRatio inliers it is only refined
+void homographyEstimator::setTemporalPrior(bool temporalPrior, double priorInlierRatio)
+{
+	this->temporalPrior = temporalPrior;
+	this->priorInlierRatio = priorInlierRatio;
+}
+
+
+// Forget the previous homographies, to be used when the sequence is cut
+void homographyEstimator::resetHistory()
+{
+	history = 0;
+}
+
+
+// Number of points reprojected closer than threshold, or -1 as soon as the model cannot beat best
+int homographyEstimator::score(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const cv::Matx33d &H, int best, std::vector<uchar> &mask)
+{
+	int n = (int) src.size();
+	int count = 0;
+	double threshold2 = threshold*threshold;
+
+	for(int i=0; i<n; ++i)
+	{
+		double x = src[i].x, y = src[i].y;
+		double w = 1./(H(2,0)*x + H(2,1)*y + H(2,2));
+		double dx = (H(0,0)*x + H(0,1)*y + H(0,2))*w - dst[i].x;
+		double dy = (H(1,0)*x + H(1,1)*y + H(1,2))*w - dst[i].y;
+
+		mask[i] = (dx*dx + dy*dy < threshold2);
+		count += mask[i];
+
+		if (count + (n-i-1) <= best)
+			return -1;
+	}
+	return count;
+}
+
+
+// Least squares homography on all the inliers, computed on normalized coordinates
+bool homographyEstimator::refine(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const std::vector<uchar> &mask, cv::Matx33d &H)
+{
+	int n = (int) src.size();
+	int count = 0;
+	cv::Point2d srcMean(0,0), dstMean(0,0);
+	for(int i=0; i<n; ++i)
+		if (mask[i])
+		{
+			srcMean += cv::Point2d(src[i].x, src[i].y);
+			dstMean += cv::Point2d(dst[i].x, dst[i].y);
+			count++;
+		}
+	if (count < SAMPLE_SIZE)
+		return false;
+	srcMean *= 1./count;
+	dstMean *= 1./count;
+
+	double srcScale = 0, dstScale = 0;
+	for(int i=0; i<n; ++i)
+		if (mask[i])
+		{
+			srcScale += cv::norm(cv::Point2d(src[i].x, src[i].y) - srcMean);
+			dstScale += cv::norm(cv::Point2d(dst[i].x, dst[i].y) - dstMean);
+		}
+	if (srcScale < 1e-6 || dstScale < 1e-6)
+		return false;
+	srcScale = count*std::sqrt(2.)/srcScale;
+	dstScale = count*std::sqrt(2.)/dstScale;
+
+	// Normal equations of the 8 unknowns, h33 = 1
+	double A[8][9] = {};
+	for(int i=0; i<n; ++i)
+		if (mask[i])
+		{
+			double x = (src[i].x - srcMean.x)*srcScale, y = (src[i].y - srcMean.y)*srcScale;
+			double u = (dst[i].x - dstMean.x)*dstScale, v = (dst[i].y - dstMean.y)*dstScale;
+			double row1[8] = { x, y, 1, 0, 0, 0, -u*x, -u*y };
+			double row2[8] = { 0, 0, 0, x, y, 1, -v*x, -v*y };
+			for(int r=0; r<8; ++r)
+			{
+				for(int c=0; c<8; ++c)
+					A[r][c] += row1[r]*row1[c] + row2[r]*row2[c];
+				A[r][8] += row1[r]*u + row2[r]*v;
+			}
+		}
+
+	double h[8];
+	if (!gaussSolve<double,8>(A, h))
+		return false;
+
+	cv::Matx33d Hn(h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7], 1);
+	cv::Matx33d Tsrc(srcScale, 0, -srcScale*srcMean.x, 0, srcScale, -srcScale*srcMean.y, 0, 0, 1);
+	cv::Matx33d TdstInv(1./dstScale, 0, dstMean.x, 0, 1./dstScale, dstMean.y, 0, 0, 1);
+	cv::Matx33d refined = TdstInv*Hn*Tsrc;
+	if (std::abs(refined(2,2)) < 1e-12)
+		return false;
+
+	H = refined*(1./refined(2,2));
+	return true;
+}
+
+
+// err gives the quality of each correspondence (LK error), the smallest ones are sampled first
+bool homographyEstimator::estimate(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const std::vector<float> &err, cv::Mat &homography, cv::Mat &mask)
+{
+	int n = (int) src.size();
+	if (n < SAMPLE_SIZE || (int) dst.size() != n)
+		return false;
+
+	// PROSAC order
+	order.resize(n);
+	for(int i=0; i<n; ++i)
+		order[i] = i;
+	if ((int) err.size() == n)
+		std::sort(order.begin(), order.end(), [&err](int a, int b) { return err[a] < err[b]; });
+
+	inliers.resize(n);
+	bestInliers.assign(n, 0);
+	int bestCount = 0;
+	cv::Matx33d bestH;
+
+	// Score the previous homography (constant velocity) and the constant acceleration prior first.
+	// previousH2^-1 previousH is the change of motion between the last two frames, applied once more
+	int candidates = 0;
+	cv::Matx33d priors[2];
+	if (temporalPrior && history > 0)
+		priors[candidates++] = previousH;
+	if (temporalPrior && history > 1)
+	{
+		cv::Matx33d accelerated = previousH*previousH2.inv()*previousH;
+		if (std::abs(accelerated(2,2)) > 1e-12)
+			priors[candidates++] = accelerated*(1./accelerated(2,2));
+	}
+
+	for(int i=0; i<candidates; ++i)
+	{
+		int count = score(src, dst, priors[i], bestCount, inliers);
+		if (count > bestCount)
+		{
+			bestCount = count;
+			bestH = priors[i];
+			bestInliers.swap(inliers);
+		}
+	}
+
+	// Verification only when the prior still fits, otherwise RANSAC starts from it
+	if (candidates == 0 || bestCount < priorInlierRatio*n)
+		ransac(src, dst, bestH, bestCount);
+
+	if (bestCount < SAMPLE_SIZE)
+	{
+		history = 0;
+		return false;
+	}
+
+	// Refine on all the inliers, the refined model is kept if it does not lose any
+	cv::Matx33d refinedH = bestH;
+	if (refine(src, dst, bestInliers, refinedH) && score(src, dst, refinedH, -1, inliers) >= bestCount)
+	{
+		bestH = refinedH;
+		bestInliers.swap(inliers);
+	}
+
+	previousH2 = previousH;
+	previousH = bestH;
+	history++;
+
+	homography = cv::Mat(bestH, true);
+	mask.create(n, 1, CV_8U);
+	for(int i=0; i<n; ++i)
+		mask.at<uchar>(i) = bestInliers[i];
+	return true;
+}
+
+
+// PROSAC loop, bestH and bestCount may already hold a model to beat
+void homographyEstimator::ransac(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, cv::Matx33d &bestH, int &bestCount)
+{
+	int n = (int) src.size();
+
+	// Growth function of PROSAC : Tn is the expected number of samples drawn from the first
+	// subset points after maxIterations, TnPrime the iteration at which the subset grows
+	int subset = SAMPLE_SIZE;
+	double Tn = maxIterations;
+	for(int i=0; i<SAMPLE_SIZE; ++i)
+		Tn *= (double) (SAMPLE_SIZE-i)/(n-i);
+	int TnPrime = 1;
+
+	int iterations = maxIterations;
+	if (bestCount > 0)
+		iterations = neededIterations((double) bestCount/n, confidence, maxIterations);
+
+	for(int t=1; t<=iterations; ++t)
+	{
+		if (t == TnPrime && subset < n)
+		{
+			double TnNext = Tn*(subset+1)/(subset+1-SAMPLE_SIZE);
+			TnPrime += (int) std::ceil(TnNext - Tn);
+			Tn = TnNext;
+			subset++;
+		}
+
+		// Sample among the first subset points, the last one is forced once its turn has passed
+		int idx[SAMPLE_SIZE];
+		int drawn = 0;
+		int range = subset;
+		if (TnPrime < t)
+		{
+			idx[drawn++] = subset-1;
+			range = subset-1;
+		}
+		while (drawn < SAMPLE_SIZE)
+		{
+			int k = rng.uniform(0, range);
+			bool unique = true;
+			for(int j=0; j<drawn; ++j)
+				unique = unique && idx[j] != k;
+			if (unique)
+				idx[drawn++] = k;
+		}
+
+		cv::Point2d s[SAMPLE_SIZE], d[SAMPLE_SIZE];
+		for(int j=0; j<SAMPLE_SIZE; ++j)
+		{
+			s[j] = cv::Point2d(src[order[idx[j]]].x, src[order[idx[j]]].y);
+			d[j] = cv::Point2d(dst[order[idx[j]]].x, dst[order[idx[j]]].y);
+		}
+		if (degenerateSample(s) || degenerateSample(d))
+			continue;
+
+		cv::Matx33d H;
+		if (!solveHomography4<double>(s, d, H))
+			continue;
+
+		int count = score(src, dst, H, bestCount, inliers);
+		if (count <= bestCount)
+			continue;
+
+		bestCount = count;
+		bestH = H;
+		bestInliers.swap(inliers);
+
+		// Standard RANSAC stopping criterion
+		iterations = std::max(t, neededIterations((double) bestCount/n, confidence, maxIterations));
+	}
+}
+
+
+// Plain RANSAC order when the quality of the correspondences is unknown
+bool homographyEstimator::estimate(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, cv::Mat &homography, cv::Mat &mask)
+{
+	return estimate(src, dst, std::vector<float>(), homography, mask);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Standard libraries
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+
+// Solve the N x N system stored in A with its right hand side in the last column
+// Gauss elimination with partial pivoting, everything stays on the stack
+template <typename T, int N>
+bool gaussSolve(T A[N][N+1], T x[N])
+{
+	for(int c=0; c<N; ++c)
+	{
+		int pivot = c;
+		for(int r=c+1; r<N; ++r)
+			if (std::abs(A[r][c]) > std::abs(A[pivot][c]))
+				pivot = r;
+		if (std::abs(A[pivot][c]) < 1e-10)
+			return false;
+		if (pivot != c)
+			for(int j=c; j<=N; ++j)
+				std::swap(A[c][j], A[pivot][j]);
+
+		for(int r=c+1; r<N; ++r)
+		{
+			T f = A[r][c]/A[c][c];
+			for(int j=c; j<=N; ++j)
+				A[r][j] -= f*A[c][j];
+		}
+	}
+
+	for(int r=N-1; r>=0; --r)
+	{
+		T sum = A[r][N];
+		for(int j=r+1; j<N; ++j)
+			sum -= A[r][j]*x[j];
+		x[r] = sum/A[r][r];
+	}
+	return true;
+}
+
+
+// Homography from exactly 4 correspondences, h33 = 1
+template <typename T>
+bool solveHomography4(const cv::Point_<T> src[4], const cv::Point_<T> dst[4], cv::Matx<T,3,3> &H)
+{
+	T A[8][9];
+	for(int i=0; i<4; ++i)
+	{
+		T x = src[i].x, y = src[i].y, u = dst[i].x, v = dst[i].y;
+		T row1[9] = { x, y, 1, 0, 0, 0, -u*x, -u*y, u };
+		T row2[9] = { 0, 0, 0, x, y, 1, -v*x, -v*y, v };
+		for(int j=0; j<9; ++j)
+		{
+			A[2*i][j] = row1[j];
+			A[2*i+1][j] = row2[j];
+		}
+	}
+
+	T h[8];
+	if (!gaussSolve<T,8>(A, h))
+		return false;
+
+	H = cv::Matx<T,3,3>(h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7], 1);
+	return true;
+}
+
+
+// RANSAC homography estimation made for the few hundred points tracked by opticalFlow
+// The samples are drawn with PROSAC from the points with the smallest LK error first,
+// the scoring of a model stops as soon as it cannot beat the best one, and the number
+// of iterations shrinks with the best inlier ratio found so far.
+// The homographies of the last frames are tried first, RANSAC only runs when they no longer fit.
+class homographyEstimator
+{
+private:
+	double threshold;
+	int maxIterations;
+	double confidence;
+	cv::RNG rng;
+
+	std::vector<int> order;
+	std::vector<uchar> inliers;
+	std::vector<uchar> bestInliers;
+
+	// Temporal prior, previousH and previousH2 are the frame-to-frame motions of the last two frames
+	bool temporalPrior;
+	double priorInlierRatio;
+	int history;
+	cv::Matx33d previousH;
+	cv::Matx33d previousH2;
+
+	int score(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const cv::Matx33d &H, int best, std::vector<uchar> &mask);
+	bool refine(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const std::vector<uchar> &mask, cv::Matx33d &H);
+	void ransac(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, cv::Matx33d &bestH, int &bestCount);
+
+public:
+	homographyEstimator(double threshold = 3., int maxIterations = 2000, double confidence = 0.995);
+
+	bool estimate(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, const std::vector<float> &err, cv::Mat &homography, cv::Mat &mask);
+	bool estimate(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst, cv::Mat &homography, cv::Mat &mask);
+
+	void setTemporalPrior(bool temporalPrior, double priorInlierRatio = 0.8);
+	void resetHistory();
+};
@@ -19,10 +19,11 @@
 
 // Others
 #include "outputControl.h"
-#include "ticToc.h"
+#include "profiler.h"
 #include "markersDetector.h"
 #include "trackingFilter.h"
 #include "opticalFlow.h"
+#include "framePipeline.h"
 
 // Namespaces
 using namespace cv;
@@ -39,7 +40,7 @@ float const DEFAULT_FPS = 60;
 // Main funtion
 int main(int argc, char **argv) 
 {
-	if (argc != 2)
+	if (argc != 2 && !(argc == 4 && string(argv[2]) == "--trace"))
 	{
 		help();
 		return 0;
@@ -65,73 +66,67 @@ int main(int argc, char **argv)
 	
 	// Load markers
 	markersDetector markers;
-	FileStorage centers("_markers_centers.yml", FileStorage::READ);
-	markers.readMarkersFiles(centers);
+	// The binary track is mapped when it exists, the yml file is only parsed otherwise
+	markerTrackMapping track;
+	FileStorage centers;
+	if (!track.open("_markers_centers.mkt"))
+		centers.open("_markers_centers.yml", FileStorage::READ);
 	
 	// Variables initialization
-	Mat frame, frameGray,framePrev;
-	ticToc time;
+	int frameStage = profiler::stage("frame");
+	if (argc == 4 && !traceRecorder::start(argv[3]))
+		cerr << "\nFailed to open the trace file, the timeline is not recorded \n" << endl;
+	traceRecorder::setThreadName("output");
 	
 	outputControl control;
 	control.outputControlHelp(1,0,0);
 	
-	opticalFlow opticalFlow("FAST", 200, 0.86, true);
-	opticalFlow.detector->set("threshold", 30);
+	opticalFlow opticalFlow("FAST", 50, 200, 0.86, true);
 	//opticalFlow.detector->set(3, FastFeatureDetector::TYPE_9_16);
+	//opticalFlow.setForwardBackwardMode(true, 1.);
+	//opticalFlow.setGridMode(4, 4);
 	
-	// Mask creation and update
-	Mat mask(height,width, CV_8UC1,Scalar::all(225));
-	opticalFlow.markersMaskUpdate(markers.getCentersMatrix(), mask, 50);
-	
-	// Detect the feature for the fisrt frame
-	capture >>frame;
-	cvtColor(frame, frameGray, CV_BGR2GRAY);
-	opticalFlow.FeatureDetection(frameGray, mask);
-	frameGray.copyTo(framePrev);
+	// Decoding, masking, feature tracking and homography run in their own threads
+	framePipeline pipeline(capture, markers, centers, opticalFlow);
+	if (track.isOpened())
+		pipeline.setMarkersTrack(&track);
+	pipeline.start();
 	
+	framePacket packet;
+	Mat deltaX, deltaY;
 	while(true)
 	{
-		time.tic();
-		// Acquire new frame
-		capture >> frame;
-		cvtColor(frame, frameGray, CV_BGR2GRAY);
-		markers.newFrame();
-		markers.readMarkersFiles(centers);
+		scopedZone frameZone(frameStage);
 		
 		// End when video finishes
-		if (frame.empty())
+		if (!pipeline.nextFrame(packet))
 			break;
 		
-		Mat mask(height,width, CV_8UC1,Scalar::all(225));
-		opticalFlow.markersMaskUpdate(markers.getCentersMatrix(), mask, 50);
-		opticalFlow.FeatureDetection(frameGray, mask);
-		Mat foundHomography, deltaX, deltaY;
-		
-		
-		opticalFlow.findProjectiveMatrix(framePrev, frameGray,foundHomography);
-		opticalFlow.pixelDisplacment(foundHomography, deltaX, deltaY, width, height );
-		
-	
-		
-		frameGray.copyTo(framePrev);
+		traceRecorder::setFrame(packet.frameNumber);
+		scopedZone outputZone(STAGE_OUTPUT);
 		
-		opticalFlow.drawDots(markers.getCentersMatrix(),frameGray);
-		opticalFlow.drawOpticalflowArrows(frameGray);
+		// Camera motion compensated displacement of every pixel
+		if (!packet.homography.empty())
+			opticalFlow.pixelDisplacment(packet.homography, deltaX, deltaY, width, height );
 		
-		
-		opticalFlow.keyPointsUpdate(frameGray, mask);
+		opticalFlow.drawDots(packet.centersMatrix,packet.frame);
+		opticalFlow.drawOpticalflowArrows(packet.frame, packet.kptPrev, packet.kptNext, packet.hStatus);
 		
 		// Control of the output
 		char c = waitKey(1000/fps);
-		control.showVideo("Output", frameGray, (int) height/3, (int) width/3 );
+		control.showVideo("Output", packet.frame, (int) height/3, (int) width/3 );
 		if(control.quitProgram(c))
 			break;
-		
-		cout << (double) mask.rows*mask.cols/time.toc() << " pixels/second" << endl;
-		
-		
 	}
 	
+	pipeline.stop();
+	traceRecorder::stop();
+	
+	// The stages run in parallel, the throughput is given by the time between two output frames
+	profiler::summary();
+	if (profiler::totalTime(frameStage) > 0)
+		cout << (double) width*height*profiler::count(frameStage)/profiler::totalTime(frameStage) << " pixels/second" << endl;
+	
     centers.release();
     return 0;
 }
@@ -145,9 +140,10 @@ int main(int argc, char **argv)
 void help()
 {
 	cout
-	<< "\nUsage: ./program <video file or image sequence>" << endl
+	<< "\nUsage: ./program <video file or image sequence> [--trace <trace file>]" << endl
     << "Examples: " << endl
     << "Passing a video file : ./program myvideo.avi" << endl
-    << "Passing an image sequence : ./program image%03d.jpg  (if the images are numbered with 3 digits) \n" << endl;	
+    << "Passing an image sequence : ./program image%03d.jpg  (if the images are numbered with 3 digits)" << endl
+    << "Recording the timeline of the stages : ./program myvideo.avi --trace trace.json  (open it in chrome://tracing or ui.perfetto.dev) \n" << endl;	
 }
 
@@ -0,0 +1,158 @@
+/*
+ * << mainAllocationCheck >> counts the heap allocations of the per-frame feature tracking path
+ * (rotation of the buffers, refresh of the key points and hand-off of the matched points to the
+ * next stage) once the buffers are warmed up, on a synthetic moving texture.
+ * The feature detection and the optical flow (pyramids and Lucas-Kanade) are counted apart,
+ * OpenCV allocates inside them at every call.
+ * Returns 1 when the tracking path still allocates in steady state
+ *
+ */
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+// Others
+#include "opticalFlow.h"
+#include "framePipeline.h"
+
+// Namespaces
+using namespace cv;
+using namespace std;
+
+
+// Every operator new of the program goes through this counter
+std::atomic<long> allocations(0);
+
+void *operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = std::malloc(size ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+
+// My functions
+void help();
+
+// Global parametres
+int const DEFAULT_WARM_UP = 30;
+int const DEFAULT_FRAMES = 100;
+int const WIDTH = 640;
+int const HEIGHT = 480;
+
+
+// Blurred noise moving by a sub-pixel translation at each frame
+vector<Mat> syntheticFrames(int count)
+{
+	RNG rng(12345);
+	Mat texture(HEIGHT + 2*count, WIDTH + 2*count, CV_8UC1);
+	rng.fill(texture, RNG::UNIFORM, 0, 256);
+	GaussianBlur(texture, texture, Size(5,5), 1.5);
+
+	vector<Mat> frames(count);
+	for(int f=0; f<count; ++f)
+	{
+		Mat shift = (Mat_<double>(2,3) << 1, 0, -0.8*f, 0, 1, -0.4*f);
+		warpAffine(texture, frames.at(f), shift, Size(WIDTH, HEIGHT));
+	}
+	return frames;
+}
+
+
+// Main funtion
+int main(int argc, char **argv)
+{
+	if (argc > 1 && string(argv[1]) == "--help")
+	{
+		help();
+		return 0;
+	}
+
+	int warmUp = (argc > 1) ? atoi(argv[1]) : DEFAULT_WARM_UP;
+	int frames = (argc > 2) ? atoi(argv[2]) : DEFAULT_FRAMES;
+	vector<Mat> sequence = syntheticFrames(warmUp + frames);
+
+	// Track stage -> output -> back to the track stage, like framePipeline
+	opticalFlow flow("FAST", 50, 200, 0.86, true);
+	boundedQueue<framePacket> tracked(4), recycled(8);
+	framePacket packet, output;
+
+	long detection = 0, flowAllocations = 0, tracking = 0;
+	for(int f=0; f<warmUp + frames; ++f)
+	{
+		bool counted = (f >= warmUp);
+
+		long start = allocations.load();
+		flow.FeatureDetection(sequence.at(f), Mat());
+		if (counted)
+			detection += allocations.load() - start;
+
+		if (f == 0)
+			continue;
+
+		start = allocations.load();
+		flow.trackFeatures(sequence.at(f-1), sequence.at(f));
+		if (counted)
+			flowAllocations += allocations.load() - start;
+
+		start = allocations.load();
+		framePacket spent;
+		if (recycled.tryPop(spent))
+		{
+			packet.kptPrev.swap(spent.kptPrev);
+			packet.kptNext.swap(spent.kptNext);
+			packet.err.swap(spent.err);
+		}
+		flow.getMatchedPoints(packet.kptPrev, packet.kptNext, packet.err);
+		flow.keyPointsUpdate(sequence.at(f), Mat());
+		tracked.tryPush(packet);
+
+		// Output of the frame, then its buffers go back
+		tracked.tryPop(output);
+		output.kptPrev.swap(spent.kptPrev);
+		output.kptNext.swap(spent.kptNext);
+		output.err.swap(spent.err);
+		recycled.tryPush(spent);
+		if (counted)
+			tracking += allocations.load() - start;
+	}
+
+	cout << frames << " frames after " << warmUp << " frames of warm-up" << endl
+		 << "Feature detection (OpenCV) : " << (double) detection/frames << " allocations/frame" << endl
+		 << "Optical flow (OpenCV)      : " << (double) flowAllocations/frames << " allocations/frame" << endl
+		 << "Tracking and hand-off      : " << (double) tracking/frames << " allocations/frame" << endl;
+
+	if (tracking > 0)
+	{
+		cout << "The steady-state tracking path allocates" << endl;
+		return 1;
+	}
+	cout << "No allocation in the steady-state tracking path" << endl;
+	return 0;
+}
+
+
+
+// Help function
+void help()
+{
+	cout
+	<< "\nUsage: ./program [warm-up frames] [counted frames]" << endl
+	<< "Example: ./program 30 100 \n" << endl;
+}
@@ -1,13 +1,18 @@
 /*
- * Author:	Hélène Loozen 
+ * Author:	Hélène Loozen
  * Date:	2016
- * 
+ *
  */
 
 // Standard libraries
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 #include <math.h>
 
 // OpenCV libraries
@@ -18,9 +23,7 @@
 #include <opencv2/nonfree/nonfree.hpp>
 
 // Others
-#include "outputControl.h"
 #include "opticalFlow.h"
-#include "ticToc.h"
 
 // Namespaces
 using namespace cv;
@@ -31,150 +34,240 @@ using namespace std;
 void help();
 
 // Global parametres
-float const DEFAULT_FPS = 60;
+int const DEFAULT_FIRST_FRAME = 0;
+int const DEFAULT_FRAME_COUNT = 100;
+int const DEFAULT_WARM_UP = 5;
+string const DEFAULT_OUTPUT = "detectorBenchmark";
 
 
-// 
+// A detector of initFeatureDetector, possibly with one parametre changed
+struct detectorConfig
+{
+	string name;
+	string detector;
+	string parameter;
+	int value;
+};
+
+
+// Measures of one configuration over all the frames
+struct detectorResult
+{
+	detectorConfig config;
+	vector<double> frameTimes;		// Wall-clock time of each frame (ms)
+	double wallTime;				// Sum of the wall-clock times (s)
+	double cpuTime;					// Process CPU time (s), above wallTime when OpenCV uses several threads
+	double keypoints;				// Total number of keypoints
+};
+
+
+// Every detector of initFeatureDetector, and the variants that are used in the programs
+vector<detectorConfig> detectorConfigs()
+{
+	detectorConfig configs[] = {
+		{"FAST",			"FAST",		"",				0},
+		{"FAST_t10",		"FAST",		"threshold",	10},
+		{"ORB",				"ORB",		"",				0},
+		{"ORB_n200",		"ORB",		"nFeatures",	200},
+		{"BRISK",			"BRISK",	"",				0},
+		{"HARRIS",			"HARRIS",	"",				0},
+		{"HARRIS_n1000",	"HARRIS",	"nfeatures",	1000},
+		{"STAR",			"STAR",		"",				0},
+		{"SIFT",			"SIFT",		"",				0},
+		{"SURF",			"SURF",		"",				0},
+		{"MSER",			"MSER",		"",				0}
+	};
+	return vector<detectorConfig>(configs, configs + sizeof(configs)/sizeof(configs[0]));
+}
+
+
+// p-th percentile (0-100) of the values, linear interpolation between the closest ranks
+double percentile(vector<double> values, double p)
+{
+	if (values.empty())
+		return 0;
+
+	sort(values.begin(), values.end());
+	double rank = p/100.*(values.size()-1);
+	int low = (int) floor(rank);
+	int high = min(low+1, (int) values.size()-1);
+	return values.at(low) + (rank-low)*(values.at(high)-values.at(low));
+}
 
-double getOnes(std::vector<uchar> vector)
+
+// Time the detector on every frame, after warmUp untimed frames
+detectorResult runDetector(const detectorConfig &config, const vector<Mat> &frames, int warmUp)
 {
-	double output = 0;
-	for(int i=0; i< vector.size(); ++i)
-		if(vector.at(i) == 1)
-			output++;
-	
-	return output/vector.size();
+	detectorResult result;
+	result.config = config;
+	result.wallTime = 0;
+	result.cpuTime = 0;
+	result.keypoints = 0;
+	result.frameTimes.reserve(frames.size());
+
+	opticalFlow features(config.detector);
+	if (!config.parameter.empty())
+		features.setDetectorParameter(config.parameter, config.value);
+
+	// Warm-up : caches, lazy allocations and OpenCV thread pool
+	for(int i=0; i<warmUp; ++i)
+		features.FeatureDetectorOnly(frames.at(i % frames.size()));
+
+	clock_t cpuStart = clock();
+	for(int i=0; i<frames.size(); ++i)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		int count = features.FeatureDetectorOnly(frames.at(i));
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+		double ms = chrono::duration<double, milli>(end - start).count();
+		result.frameTimes.push_back(ms);
+		result.wallTime += ms/1000.;
+		result.keypoints += count;
+	}
+	result.cpuTime = ((double) (clock() - cpuStart))/CLOCKS_PER_SEC;
+
+	return result;
+}
+
+
+// One line per configuration
+void writeCSV(string filename, const vector<detectorResult> &results, int width, int height)
+{
+	ofstream file(filename.c_str());
+	file << "detector,parameter,value,frames,width,height,wall_s,cpu_s,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,keypoints_per_frame,keypoints_per_s,pixels_per_s" << endl;
+
+	for(int i=0; i<results.size(); ++i)
+	{
+		const detectorResult &r = results.at(i);
+		int frames = r.frameTimes.size();
+		file << r.config.name << "," << r.config.parameter << "," << r.config.value << ","
+			 << frames << "," << width << "," << height << ","
+			 << r.wallTime << "," << r.cpuTime << ","
+			 << 1000*r.wallTime/frames << ","
+			 << percentile(r.frameTimes, 50) << "," << percentile(r.frameTimes, 95) << "," << percentile(r.frameTimes, 99) << ","
+			 << *max_element(r.frameTimes.begin(), r.frameTimes.end()) << ","
+			 << r.keypoints/frames << ","
+			 << r.keypoints/r.wallTime << ","
+			 << (double) width*height*frames/r.wallTime << endl;
+	}
+}
+
+
+// Same measures, with the run description and the per-frame times
+void writeJSON(string filename, string sequence, const vector<detectorResult> &results, int width, int height, int firstFrame, int warmUp)
+{
+	ofstream file(filename.c_str());
+	file << "{" << endl
+		 << "  \"sequence\": \"" << sequence << "\"," << endl
+		 << "  \"opencv\": \"" << CV_VERSION << "\"," << endl
+		 << "  \"threads\": " << getNumThreads() << "," << endl
+		 << "  \"width\": " << width << "," << endl
+		 << "  \"height\": " << height << "," << endl
+		 << "  \"firstFrame\": " << firstFrame << "," << endl
+		 << "  \"warmUp\": " << warmUp << "," << endl
+		 << "  \"detectors\": [" << endl;
+
+	for(int i=0; i<results.size(); ++i)
+	{
+		const detectorResult &r = results.at(i);
+		int frames = r.frameTimes.size();
+		file << "    {" << endl
+			 << "      \"name\": \"" << r.config.name << "\"," << endl
+			 << "      \"detector\": \"" << r.config.detector << "\"," << endl
+			 << "      \"parameter\": \"" << r.config.parameter << "\"," << endl
+			 << "      \"value\": " << r.config.value << "," << endl
+			 << "      \"frames\": " << frames << "," << endl
+			 << "      \"wallSeconds\": " << r.wallTime << "," << endl
+			 << "      \"cpuSeconds\": " << r.cpuTime << "," << endl
+			 << "      \"meanMs\": " << 1000*r.wallTime/frames << "," << endl
+			 << "      \"p50Ms\": " << percentile(r.frameTimes, 50) << "," << endl
+			 << "      \"p95Ms\": " << percentile(r.frameTimes, 95) << "," << endl
+			 << "      \"p99Ms\": " << percentile(r.frameTimes, 99) << "," << endl
+			 << "      \"keypointsPerFrame\": " << r.keypoints/frames << "," << endl
+			 << "      \"keypointsPerSecond\": " << r.keypoints/r.wallTime << "," << endl
+			 << "      \"pixelsPerSecond\": " << (double) width*height*frames/r.wallTime << "," << endl
+			 << "      \"frameMs\": [";
+		for(int j=0; j<frames; ++j)
+			file << (j ? ", " : "") << r.frameTimes.at(j);
+		file << "]" << endl
+			 << "    }" << (i+1 < results.size() ? "," : "") << endl;
+	}
+	file << "  ]" << endl << "}" << endl;
 }
 
 
 
 // Main funtion
-int main(int argc, char **argv) 
+int main(int argc, char **argv)
 {
-	if (argc != 2)
+	if (argc < 2 || argc > 6)
 	{
 		help();
 		return 0;
 	}
-    
+
     // Open the video or images sequence
     string sequence = argv[1];
     VideoCapture capture(sequence);
-	
+
 	if (!capture.isOpened())
 	{
 		cerr << "\nFailed to open the video file or image sequence \n" << endl;
 		return -1;
     }
-    
-    // Get the video properties
-    double width = capture.get(CV_CAP_PROP_FRAME_WIDTH);
-    double height = capture.get(CV_CAP_PROP_FRAME_HEIGHT);
-    double fps = capture.get(CV_CAP_PROP_FPS);
-	if (fps!=fps)
-		fps=DEFAULT_FPS;
-	
-	// Variables initialization
-	ticToc time;
-	outputControl control;
-	
-	Mat frame, framePrev;
-	std::vector<uchar> status;
-	double ExecutionTimeFast1, ExecutionTimeFast2, ExecutionTimeSift, ExecutionTimeSurf, ExecutionTimeOrb1, ExecutionTimeOrb2, ExecutionTimeHarris1, ExecutionTimeHarris2, ExecutionTimeMser = 0;
-	int nbFeaturesFast1, nbFeaturesFast2, nbFeaturesSift, nbFeaturesSurf, nbFeaturesOrb1, nbFeaturesOrb2, nbFeaturesHarris1, nbFeaturesHarris2, nbFeaturesMser = 0;
-	
-	
-
-	opticalFlow FASTfeatures1("FAST");
-	opticalFlow FASTfeatures2("FAST");
-	FASTfeatures2.detector->set("threshold", 30);
-	
-	opticalFlow ORBfeatures1("ORB");
-	opticalFlow ORBfeatures2("ORB");
-	ORBfeatures2.detector->set("nFeatures", 200);
-	
-	opticalFlow HARRISfeatures1("HARRIS");
-	opticalFlow HARRISfeatures2("HARRIS");
-	HARRISfeatures2.detector->set("nfeatures",200);
-
-	opticalFlow MSERfeatures("MSER");
-	
-	opticalFlow SURFfeatures("SURF");
-	
-	opticalFlow SIFTfeatures("SIFT");
-	
-	
-	int framecount;
-	
-	for (framecount = 0 ; framecount<50; ++ framecount )
+
+	int firstFrame = (argc > 2) ? atoi(argv[2]) : DEFAULT_FIRST_FRAME;
+	int frameCount = (argc > 3) ? atoi(argv[3]) : DEFAULT_FRAME_COUNT;
+	int warmUp = (argc > 4) ? atoi(argv[4]) : DEFAULT_WARM_UP;
+	string output = (argc > 5) ? argv[5] : DEFAULT_OUTPUT;
+
+	// Decode the frame range once, so that decoding is not timed and every detector sees the same frames
+	Mat frame, frameGray;
+	for(int i=0; i<firstFrame; ++i)
+		if (!capture.grab())
+			break;
+
+	vector<Mat> frames;
+	while(frames.size() < frameCount)
 	{
-		cout << framecount+1 << endl;
-		
-		// Acquire new frame
 		capture >> frame;
-		if (framePrev.empty())
-			frame.copyTo(framePrev);
-		
-		// End when video finishes
 		if (frame.empty())
 			break;
-		
-		
-		time.tic();
-		nbFeaturesFast1 += FASTfeatures1.FeatureDetectorOnly(frame);
-		ExecutionTimeFast1 += time.toc();
-		
-		time.tic();
-		nbFeaturesFast2 += FASTfeatures2.FeatureDetectorOnly(frame);
-		ExecutionTimeFast2 += time.toc();
-		
-		time.tic();
-		nbFeaturesSift +=SIFTfeatures.FeatureDetectorOnly(frame);
-		ExecutionTimeSift += time.toc();
-		
-		time.tic();
-		nbFeaturesSurf += SURFfeatures.FeatureDetectorOnly(frame);
-		ExecutionTimeSurf += time.toc();
-		
-		time.tic();
-		nbFeaturesOrb1 += ORBfeatures1.FeatureDetectorOnly(frame);
-		ExecutionTimeOrb1 += time.toc();
-		
-		time.tic();
-		nbFeaturesOrb2 += ORBfeatures2.FeatureDetectorOnly(frame);
-		ExecutionTimeOrb2 += time.toc();
-		
-		time.tic();
-		nbFeaturesHarris1 += HARRISfeatures1.FeatureDetectorOnly(frame);
-		ExecutionTimeHarris1 += time.toc();
-
-		time.tic();
-		nbFeaturesHarris2 += HARRISfeatures2.FeatureDetectorOnly(frame);
-		ExecutionTimeHarris2 += time.toc();
-		
-		time.tic();
-		nbFeaturesMser += MSERfeatures.FeatureDetectorOnly(frame);
-		ExecutionTimeMser += time.toc();
-
-		
-		
-		// Control of the output
-		char c = waitKey(1);
-		if(control.quitProgram(c))
-			break;
+		cvtColor(frame, frameGray, CV_BGR2GRAY);
+		frames.push_back(frameGray.clone());
 	}
-	
-	cout << "Relative execution time FAST : "<< ExecutionTimeFast1/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesFast1/framecount <<  endl;
-	cout << "Relative execution time FAST (30) : "<< ExecutionTimeFast2/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesFast2/framecount <<  endl;
-	cout << "Relative execution time ORB : "<< ExecutionTimeOrb1/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesOrb1/framecount <<  endl;
-	cout << "Relative execution time ORB (200) : "<< ExecutionTimeOrb2/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesOrb2/framecount <<  endl;
-	cout << "Relative execution time HARRIS : "<< ExecutionTimeHarris1/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesHarris1/framecount <<endl;
-	cout << "Relative execution time HARRIS (200) : "<< ExecutionTimeHarris2/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesHarris2/framecount <<endl;
-	cout << "Relative execution time SIFT : "<< ExecutionTimeSift/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesSift/framecount <<   endl;
-    cout << "Relative execution time SURF : "<< ExecutionTimeSurf/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesSurf/framecount << endl;
-    cout << "Relative execution time MSER : "<< ExecutionTimeMser/ExecutionTimeFast1 << " -- Features :"<< nbFeaturesMser/framecount <<  endl;
-	
-	
+
+	if (frames.empty())
+	{
+		cerr << "\nNo frame in the requested range ! \n" << endl;
+		return -1;
+	}
+
+	int width = frames.front().cols;
+	int height = frames.front().rows;
+	cout << frames.size() << " frames of " << width << "x" << height << " from frame " << firstFrame << " -- Warm-up : " << warmUp << " frames" << endl;
+
+	// Run every detector
+	vector<detectorConfig> configs = detectorConfigs();
+	vector<detectorResult> results;
+	for(int i=0; i<configs.size(); ++i)
+	{
+		results.push_back(runDetector(configs.at(i), frames, warmUp));
+
+		const detectorResult &r = results.back();
+		cout << r.config.name
+			 << " -- Mean : " << 1000*r.wallTime/frames.size() << " ms"
+			 << " -- p50/p95/p99 : " << percentile(r.frameTimes, 50) << "/" << percentile(r.frameTimes, 95) << "/" << percentile(r.frameTimes, 99) << " ms"
+			 << " -- CPU/wall : " << r.cpuTime/r.wallTime
+			 << " -- Features : " << r.keypoints/frames.size()
+			 << " -- Relative execution time : " << r.wallTime/results.front().wallTime << endl;
+	}
+
+	writeCSV(output + ".csv", results, width, height);
+	writeJSON(output + ".json", sequence, results, width, height, firstFrame, warmUp);
+	cout << "Results written in " << output << ".csv and " << output << ".json" << endl;
+
     return 0;
 }
 
@@ -187,8 +280,10 @@ int main(int argc, char **argv)
 void help()
 {
 	cout
-	<< "\nUsage: ./program <video file or image sequence>" << endl
+	<< "\nUsage: ./program <video file or image sequence> [first frame] [frame count] [warm-up frames] [output name]" << endl
     << "Examples: " << endl
     << "Passing a video file : ./program myvideo.avi" << endl
-    << "Passing an image sequence : ./program image%03d.jpg  (if the images are numbered with 3 digits) \n" << endl;	
-}
\ No newline at end of file
+    << "Passing an image sequence : ./program image%03d.jpg  (if the images are numbered with 3 digits)" << endl
+    << "Timing the frames 100 to 399 after 10 warm-up frames : ./program myvideo.avi 100 300 10 results" << endl
+    << "The measures are written in <output name>.csv and <output name>.json (default " << DEFAULT_OUTPUT << ") \n" << endl;
+}
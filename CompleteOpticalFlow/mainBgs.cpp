@@ -19,7 +19,7 @@
 
 // Others
 #include "outputControl.h"
-#include "ticToc.h"
+#include "profiler.h"
 #include "markersDetector.h"
 #include "trackingFilter.h"
 #include "opticalFlow.h"
@@ -85,7 +85,8 @@ int main(int argc, char **argv)
 	
 	// Variables initialization
 	Mat frame,frameGray, framePrev;
-	ticToc time;
+	int frameStage = profiler::stage("frame");
+	int bgsStage = profiler::stage("background subtraction");
 	
 	outputControl control;
 	control.outputControlHelp(1,0,1);
@@ -96,18 +97,28 @@ int main(int argc, char **argv)
 	
 	while(true)
 	{
-		time.tic();
-		// Acquire new frame
-		capture >> frame;
-		cvtColor(frame, frameGray, CV_BGR2GRAY);
+		scopedZone frameZone(frameStage);
 		
+		// Acquire new frame
+		{
+			scopedZone zone(STAGE_CAPTURE);
+			capture >> frame;
+		}
 		
 		// End when video finishes
 		if (frame.empty())
 			break;
 		
+		{
+			scopedZone zone(STAGE_GRAY);
+			cvtColor(frame, frameGray, CV_BGR2GRAY);
+		}
 		
-		Mat bgsMask = bgsVibe->process(frameGray);
+		Mat bgsMask;
+		{
+			scopedZone zone(bgsStage);
+			bgsMask = bgsVibe->process(frameGray);
+		}
 		//BgsPostprocess(bgsMask,bgsMask);
 		
 		frame.copyTo(framePrev);
@@ -129,11 +140,12 @@ int main(int argc, char **argv)
 		control.screenshot(c, frame);
 		control.screenshot(c, bgsMask);
 		
-		cout << (double) width*height/time.toc() << " pixels/second" << endl;
-		
-		
 	}
 	delete bgsVibe;
+	
+	profiler::summary();
+	if (profiler::totalTime(frameStage) > 0)
+		cout << (double) width*height*profiler::count(frameStage)/profiler::totalTime(frameStage) << " pixels/second" << endl;
     return 0;
 }
 
@@ -19,7 +19,7 @@
 
 // Others
 #include "outputControl.h"
-#include "ticToc.h"
+#include "profiler.h"
 #include "markersDetector.h"
 #include "trackingFilter.h"
 
@@ -70,22 +70,22 @@ int main(int argc, char **argv)
 		
 		for (int i =0; i<foundMarkers.getCentersMatrix().cols; ++i)
 		{
-			Mat newCoordinates = KFS.at(i).applyFilter(foundMarkers.getCentersMatrix().at<float>(0,i),
+			Point2f newCoordinates = KFS.at(i).applyFilter(foundMarkers.getCentersMatrix().at<float>(0,i),
 													   foundMarkers.getCentersMatrix().at<float>(1,i));
-			foundMarkers.getCentersMatrix().at<float>(0,i) = newCoordinates.at<float>(0);
-			foundMarkers.getCentersMatrix().at<float>(1,i) = newCoordinates.at<float>(1);
+			foundMarkers.getCentersMatrix().at<float>(0,i) = newCoordinates.x;
+			foundMarkers.getCentersMatrix().at<float>(1,i) = newCoordinates.y;
 			
 			
 			for(int j=0; j<foundMarkers.getCornersMatrix().rows/2 ; ++j)
 			{
-				Mat updatedCorner =  KFS.at(i).updateRelativePosition(foundMarkers.getCentersMatrix().at<float>(0,i),
+				Point2f updatedCorner =  KFS.at(i).updateRelativePosition(foundMarkers.getCentersMatrix().at<float>(0,i),
 																	  foundMarkers.getCentersMatrix().at<float>(1,i), 
 																	  foundMarkers.getCornersMatrix().at<float>((2*j),i),
 																	  foundMarkers.getCornersMatrix().at<float>((2*j)+1,i),
 																	  deltaC.at<float>((2*j),i) , 
 																	  deltaC.at<float>((2*j)+1,i));
-				foundMarkers.getCornersMatrix().at<float>((2*j),i) = updatedCorner.at<float>(0);
-				foundMarkers.getCornersMatrix().at<float>((2*j)+1,i) = updatedCorner.at<float>(1);
+				foundMarkers.getCornersMatrix().at<float>((2*j),i) = updatedCorner.x;
+				foundMarkers.getCornersMatrix().at<float>((2*j)+1,i) = updatedCorner.y;
 			}
 		}
 		
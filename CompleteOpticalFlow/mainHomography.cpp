@@ -0,0 +1,204 @@
+/*
+ * << mainHomography >> compares the homographyEstimator of opticalFlow with cv::findHomography
+ * on the point sets recorded from a video
+ *
+ */
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <math.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include <opencv2/nonfree/nonfree.hpp>
+
+// Others
+#include "opticalFlow.h"
+#include "homographyEstimator.h"
+#include "profiler.h"
+
+// Namespaces
+using namespace cv;
+using namespace std;
+
+
+// My functions
+void help();
+
+// Global parametres
+int const DEFAULT_REPETITIONS = 20;
+
+
+// Record the matched features of each frame of the video
+int record(string sequence, string filename)
+{
+	VideoCapture capture(sequence);
+	if (!capture.isOpened())
+	{
+		cerr << "\nFailed to open the video file or image sequence \n" << endl;
+		return -1;
+	}
+
+	FileStorage points(filename, FileStorage::WRITE);
+	opticalFlow opticalFlow("FAST");
+
+	Mat frame, frameGray, framePrev;
+	capture >> frame;
+	if (frame.empty())
+		return -1;
+	cvtColor(frame, framePrev, CV_BGR2GRAY);
+	opticalFlow.FeatureDetection(framePrev, Mat());
+
+	int frameCount = 0;
+	while(true)
+	{
+		capture >> frame;
+		if (frame.empty())
+			break;
+		cvtColor(frame, frameGray, CV_BGR2GRAY);
+
+		opticalFlow.FeatureDetection(frameGray, Mat());
+		opticalFlow.trackFeatures(framePrev, frameGray);
+
+		vector<Point2f> kptPrev, kptNext;
+		vector<float> err;
+		opticalFlow.getMatchedPoints(kptPrev, kptNext, err);
+
+		stringstream frameNumber;
+		frameNumber << "frame" << ++frameCount;
+		points << frameNumber.str() << "{" << "prev" << kptPrev << "next" << kptNext << "err" << err << "}";
+
+		opticalFlow.keyPointsUpdate(frameGray, Mat());
+		frameGray.copyTo(framePrev);
+	}
+
+	points << "frameCount" << frameCount;
+	points.release();
+	cout << frameCount << " point sets recorded in " << filename << endl;
+	return 0;
+}
+
+
+// Mean distance between the projections of the inliers by two homographies
+double transferDifference(Mat H1, Mat H2, vector<Point2f> &points, Mat mask)
+{
+	vector<Point2f> p1, p2;
+	perspectiveTransform(points, p1, H1);
+	perspectiveTransform(points, p2, H2);
+
+	double sum = 0;
+	int count = 0;
+	for(int i=0; i<points.size(); ++i)
+		if (mask.at<uchar>(i))
+		{
+			sum += norm(p1.at(i) - p2.at(i));
+			count++;
+		}
+	return count > 0 ? sum/count : 0;
+}
+
+
+// Main funtion
+int main(int argc, char **argv)
+{
+	if (argc == 4 && string(argv[1]) == "record")
+		return record(argv[2], argv[3]);
+
+	if (argc != 2 && argc != 3)
+	{
+		help();
+		return 0;
+	}
+
+	FileStorage points(argv[1], FileStorage::READ);
+	if (!points.isOpened())
+	{
+		cerr << "\nError opening the point sets file ! \n" << endl;
+		return -1;
+	}
+	int repetitions = (argc == 3) ? atoi(argv[2]) : DEFAULT_REPETITIONS;
+	int frameCount = (int) points["frameCount"];
+
+	// Variables initialization
+	int openCVStage = profiler::stage("findHomography");
+	int estimatorStage = profiler::stage("homographyEstimator");
+	homographyEstimator estimator;
+	
+	// Each set is estimated several times, the prior would only verify the previous repetition
+	estimator.setTemporalPrior(false);
+	double inliersOpenCV = 0, inliersEstimator = 0, difference = 0;
+	int sets = 0;
+
+	for(int frame = 1; frame <= frameCount; ++frame)
+	{
+		stringstream frameNumber;
+		frameNumber << "frame" << frame;
+		vector<Point2f> kptPrev, kptNext;
+		vector<float> err;
+		points[frameNumber.str()]["prev"] >> kptPrev;
+		points[frameNumber.str()]["next"] >> kptNext;
+		points[frameNumber.str()]["err"] >> err;
+
+		if (kptPrev.size() < 4)
+			continue;
+
+		Mat homographyOpenCV, homographyFixed, statusOpenCV, statusFixed;
+
+		for(int i=0; i<repetitions; ++i)
+		{
+			scopedZone zone(openCVStage);
+			homographyOpenCV = findHomography(kptPrev,kptNext,CV_RANSAC,3,statusOpenCV);
+		}
+
+		for(int i=0; i<repetitions; ++i)
+		{
+			scopedZone zone(estimatorStage);
+			estimator.estimate(kptPrev,kptNext,err,homographyFixed,statusFixed);
+		}
+
+		if (homographyOpenCV.empty() || homographyFixed.empty())
+			continue;
+
+		inliersOpenCV += (double) countNonZero(statusOpenCV)/kptPrev.size();
+		inliersEstimator += (double) countNonZero(statusFixed)/kptPrev.size();
+		difference += transferDifference(homographyOpenCV, homographyFixed, kptPrev, statusOpenCV);
+		sets++;
+	}
+
+	if (sets == 0)
+	{
+		cerr << "\nNo usable point set ! \n" << endl;
+		return -1;
+	}
+
+	double executionTimeOpenCV = profiler::totalTime(openCVStage);
+	double executionTimeEstimator = profiler::totalTime(estimatorStage);
+	profiler::summary();
+
+	cout << "Point sets : " << sets << " -- Repetitions : " << repetitions << endl;
+	cout << "findHomography : " << 1000*executionTimeOpenCV/(sets*repetitions) << " ms/set -- Inliers : " << 100*inliersOpenCV/sets << " %" << endl;
+	cout << "homographyEstimator : " << 1000*executionTimeEstimator/(sets*repetitions) << " ms/set -- Inliers : " << 100*inliersEstimator/sets << " %" << endl;
+	cout << "Relative execution time : " << executionTimeEstimator/executionTimeOpenCV << endl;
+	cout << "Mean transfer difference : " << difference/sets << " pixels" << endl;
+
+	points.release();
+	return 0;
+}
+
+
+
+// Help function
+void help()
+{
+	cout
+	<< "\nUsage: ./program <point sets file> [repetitions]" << endl
+	<< "       ./program record <video file or image sequence> <point sets file>" << endl
+	<< "Examples: " << endl
+	<< "Recording the point sets of a video : ./program record myvideo.avi points.yml" << endl
+	<< "Running the benchmark : ./program points.yml 50 \n" << endl;
+}
@@ -0,0 +1,241 @@
+/*
+ * << mainKalmanBenchmark >> times one update of a marker filter (transition update, prediction,
+ * correction when the marker is found) with the former cv::KalmanFilter path and with the
+ * fixed-size Kalman of kalman.h, on the same synthetic tracks, and checks that both give
+ * the same positions
+ *
+ */
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <math.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+// Others
+#include "kalman.h"
+
+// Namespaces
+using namespace cv;
+using namespace std;
+
+
+// My functions
+void help();
+
+// Global parametres
+int const DEFAULT_UPDATES = 200000;
+float const DEFAULT_MISSING = 0.2;
+int const MARKERS = 10;
+int const MAX_MISSING_DATA = 20;
+
+
+//////////////////////////////////////////////////////////////////////////
+// Former path of trackingFilter, kept here as the reference
+/////////////////////////////////////////////////////////////////////////
+
+void initKalman(cv::KalmanFilter *KF, float x , float y, float dt,float dv)
+{
+	if ( dv<0 )
+	{
+		KF->init(4,2,0);
+		KF->transitionMatrix = *(cv::Mat_<float>(4, 4) <<
+		1, 0, dt, 0,
+		0, 1, 0, dt,
+		0, 0, 1, 0,
+		0, 0, 0, 1);
+	}
+	else
+	{
+		KF->init(6,2,0);
+		KF->transitionMatrix = *(cv::Mat_<float>(6, 6) <<
+		1, 0, dt, 0, 0.5*dv, 0,
+		0, 1, 0, dt, 0, 0.5*dv,
+		0, 0, 1, 0, dv, 0,
+		0, 0, 0, 1, 0, dv,
+		0, 0, 0, 0, 1, 0,
+		0, 0, 0, 0, 0, 1);
+	}
+
+	KF->statePre.at<float>(0) = KF->statePost.at<float>(0) = x;
+	KF->statePre.at<float>(1) = KF->statePost.at<float>(1) = y;
+
+	cv::setIdentity(KF->measurementMatrix);
+	cv::setIdentity(KF->processNoiseCov, cv::Scalar::all(1e-4));
+	cv::setIdentity(KF->measurementNoiseCov, cv::Scalar::all(1e-1));
+	cv::setIdentity(KF->errorCovPost, cv::Scalar::all(.1));
+}
+
+
+void transitionMatrixUpdate (cv::KalmanFilter *KF, float dt, float dv)
+{
+	if ( dv<0 )
+		KF->transitionMatrix = *(cv::Mat_<float>(4, 4) <<
+		1, 0, dt, 0,
+		0, 1, 0, dt,
+		0, 0, 1, 0,
+		0, 0, 0, 1);
+	else
+		KF->transitionMatrix = *(cv::Mat_<float>(6, 6) <<
+		1, 0, dt, 0, 0.5*dv, 0,
+		0, 1, 0, dt, 0, 0.5*dv,
+		0, 0, 1, 0, dv, 0,
+		0, 0, 0, 1, 0, dv,
+		0, 0, 0, 0, 1, 0,
+		0, 0, 0, 0, 0, 1);
+}
+
+
+cv::Mat KalmanModelUpdate (cv::KalmanFilter *KF, float x , float y, int &missingData)
+{
+	cv::Mat predictMatrix = KF->predict();
+
+	if(missingData < MAX_MISSING_DATA && (x<0 || y<0))
+	{
+		x = predictMatrix.at<float>(0);
+		y = predictMatrix.at<float>(1);
+		missingData ++;
+	}
+	else if ((x>=0 && y>=0))
+	{
+		KF->correct((cv::Mat_<float>(2,1)<<x,y));
+		KF->statePost.at<float>(0) = x;
+		KF->statePost.at<float>(1) = y;
+		missingData = 0;
+	}
+	return (cv::Mat_<float> (1,2) << x, y);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Same update with the fixed-size filter
+/////////////////////////////////////////////////////////////////////////
+
+cv::Point2f KalmanModelUpdate (positionKalman &KF, float x , float y, int &missingData)
+{
+	cv::Point2f prediction = KF.predict();
+
+	if(missingData < MAX_MISSING_DATA && (x<0 || y<0))
+	{
+		x = prediction.x;
+		y = prediction.y;
+		missingData ++;
+	}
+	else if ((x>=0 && y>=0))
+	{
+		KF.correct(x, y);
+		KF.setPosition(x, y);
+		missingData = 0;
+	}
+	return cv::Point2f(x, y);
+}
+
+
+// Markers moving on circles at different speeds, -1 when the marker is not found
+vector<Point2f> syntheticTracks(int frames, float missing)
+{
+	RNG rng(12345);
+	vector<Point2f> measures(frames*MARKERS);
+	for(int f=0; f<frames; ++f)
+		for(int m=0; m<MARKERS; ++m)
+		{
+			float angle = 0.01f*(m+1)*f;
+			Point2f position(640 + 300*cos(angle) + rng.gaussian(0.5), 360 + 200*sin(angle) + rng.gaussian(0.5));
+			measures.at(f*MARKERS + m) = (rng.uniform(0.f, 1.f) < missing) ? Point2f(-1, -1) : position;
+		}
+	return measures;
+}
+
+
+double elapsedNs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+
+// Run both paths on the tracks, dv < 0 is the constant velocity model
+void compare(const vector<Point2f> &measures, float dt, float dv)
+{
+	int frames = measures.size()/MARKERS;
+
+	// Former path
+	vector<cv::KalmanFilter> KFs(MARKERS);
+	vector<int> missingData(MARKERS, 0);
+	vector<Point2f> reference(measures.size());
+	for(int m=0; m<MARKERS; ++m)
+		initKalman(&KFs.at(m), measures.at(m).x, measures.at(m).y, dt, dv);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int f=1; f<frames; ++f)
+		for(int m=0; m<MARKERS; ++m)
+		{
+			transitionMatrixUpdate(&KFs.at(m), missingData.at(m)/5 + dt, dv);
+			Mat coordinates = KalmanModelUpdate(&KFs.at(m), measures.at(f*MARKERS + m).x, measures.at(f*MARKERS + m).y, missingData.at(m));
+			reference.at(f*MARKERS + m) = Point2f(coordinates.at<float>(0), coordinates.at<float>(1));
+		}
+	double openCVTime = elapsedNs(start);
+
+	// Fixed-size filter
+	vector<positionKalman> filters;
+	for(int m=0; m<MARKERS; ++m)
+		filters.push_back(positionKalman(measures.at(m).x, measures.at(m).y, dt, dv));
+	fill(missingData.begin(), missingData.end(), 0);
+	vector<Point2f> result(measures.size());
+
+	start = chrono::steady_clock::now();
+	for(int f=1; f<frames; ++f)
+		for(int m=0; m<MARKERS; ++m)
+		{
+			filters.at(m).setTransition(missingData.at(m)/5 + dt, dv);
+			result.at(f*MARKERS + m) = KalmanModelUpdate(filters.at(m), measures.at(f*MARKERS + m).x, measures.at(f*MARKERS + m).y, missingData.at(m));
+		}
+	double fixedTime = elapsedNs(start);
+
+	float maxDifference = 0;
+	for(int i=MARKERS; i<result.size(); ++i)
+		maxDifference = max(maxDifference, (float) norm(result.at(i) - reference.at(i)));
+
+	int updates = (frames-1)*MARKERS;
+	cout << (dv < 0 ? "Constant velocity    " : "Constant acceleration")
+		 << " -- cv::KalmanFilter : " << openCVTime/updates << " ns/update"
+		 << " -- Kalman<" << (dv < 0 ? constantVelocity::stateDim : constantAcceleration::stateDim) << ",2> : " << fixedTime/updates << " ns/update"
+		 << " -- Speed-up : " << openCVTime/fixedTime
+		 << " -- Max difference : " << maxDifference << " px" << endl;
+}
+
+
+// Main funtion
+int main(int argc, char **argv)
+{
+	if (argc > 1 && string(argv[1]) == "--help")
+	{
+		help();
+		return 0;
+	}
+
+	int updates = (argc > 1) ? atoi(argv[1]) : DEFAULT_UPDATES;
+	float missing = (argc > 2) ? atof(argv[2]) : DEFAULT_MISSING;
+	vector<Point2f> measures = syntheticTracks(max(updates/MARKERS, 2), missing);
+
+	cout << measures.size()/MARKERS << " frames of " << MARKERS << " markers, " << missing*100 << "% missing" << endl;
+	compare(measures, 1, -1);
+	compare(measures, 1, 1);
+	return 0;
+}
+
+
+
+// Help function
+void help()
+{
+	cout
+	<< "\nUsage: ./program [updates] [missing ratio]" << endl
+	<< "Example: ./program 200000 0.2 \n" << endl;
+}
@@ -0,0 +1,197 @@
+/*
+ * << mainTrackConverter >> converts the YAML files of the markers (centers and optionally corners)
+ * into a binary marker track file, then checks the result and compares the loading times
+ * With --translation it converts the ground truth of << CameraMotionGT >> (translation or
+ * homography per frame) into a track of one "marker" holding the translation
+ *
+ */
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <chrono>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+// Others
+#include "markerTrack.h"
+
+// Namespaces
+using namespace cv;
+using namespace std;
+
+
+// My functions
+void help();
+
+
+double elapsedMs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+
+// Translation of a ground truth node, which holds either the translation or the homography
+Mat groundTruthTranslation(Mat backGT)
+{
+	if (backGT.empty())
+		return Mat();
+	if (backGT.rows == 3 && backGT.cols == 3)
+		return (Mat_<float> (2,1) << backGT.at<double>(0,2), backGT.at<double>(1,2));
+	
+	Mat translation;
+	backGT.convertTo(translation, CV_32F);
+	return translation.reshape(1, 2);
+}
+
+
+// Ground truth YAML to a one marker track
+int convertTranslation(string groundTruthFilename, string outputFilename)
+{
+	FileStorage groundTruth(groundTruthFilename, FileStorage::READ);
+	if (!groundTruth.isOpened())
+	{
+		cerr << "\nError opening " << groundTruthFilename << " ! \n" << endl;
+		return -1;
+	}
+	int frameCount = (int) groundTruth["frameCount"];
+	
+	markerTrackWriter writer;
+	if (!writer.open(outputFilename, (Mat_<int> (1,1) << 0), false))
+	{
+		cerr << "\nError opening " << outputFilename << " ! \n" << endl;
+		return -1;
+	}
+	
+	// The translations can be negative, the frames without ground truth are flagged missing apart
+	stringstream frameNumber;
+	for(int frame = 1; frame <= frameCount; ++frame)
+	{
+		Mat backGT;
+		frameNumber.str("");
+		frameNumber << "frame" << frame;
+		groundTruth[frameNumber.str()] >> backGT;
+		Mat found = (Mat_<uchar> (1,1) << (backGT.empty() ? 0 : 1));
+		writer.write(groundTruthTranslation(backGT), Mat(), found);
+	}
+	writer.close();
+	
+	cout << frameCount << " translations written in " << outputFilename << endl;
+	return 0;
+}
+
+
+// True when both matrices hold the same values
+bool sameMatrix(Mat a, Mat b)
+{
+	if (a.empty() || b.empty())
+		return a.empty() && b.empty();
+	Mat a32, b32;
+	a.convertTo(a32, CV_32F);
+	b.convertTo(b32, CV_32F);
+	return a32.size() == b32.size() && countNonZero(a32 != b32) == 0;
+}
+
+
+// Main funtion
+int main(int argc, char **argv)
+{
+	if (argc == 4 && string(argv[1]) == "--translation")
+		return convertTranslation(argv[2], argv[3]);
+	
+	if (argc != 3 && argc != 4)
+	{
+		help();
+		return 0;
+	}
+
+	string centersFilename = argv[1];
+	string cornersFilename = (argc == 4) ? argv[2] : "";
+	string outputFilename = argv[argc-1];
+
+	// Load the YAML files, this is what the binary format replaces
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	FileStorage centers(centersFilename, FileStorage::READ);
+	FileStorage corners;
+	if (!cornersFilename.empty())
+		corners.open(cornersFilename, FileStorage::READ);
+	if (!centers.isOpened() || (!cornersFilename.empty() && !corners.isOpened()))
+	{
+		cerr << "\nError opening the YAML files ! \n" << endl;
+		return -1;
+	}
+
+	Mat ids;
+	centers["ids"] >> ids;
+	int frameCount = (int) centers["frameCount"];
+
+	vector<Mat> centersMatrices(frameCount), cornersMatrices(frameCount);
+	stringstream frameNumber;
+	for(int frame = 1; frame <= frameCount; ++frame)
+	{
+		frameNumber.str("");
+		frameNumber << "frame" << frame;
+		centers[frameNumber.str()] >> centersMatrices.at(frame-1);
+		if (corners.isOpened())
+			corners[frameNumber.str()] >> cornersMatrices.at(frame-1);
+	}
+	double yamlTime = elapsedMs(start);
+
+	if (ids.empty() && frameCount > 0)
+	{
+		// Files written without the ids, the markers are only numbered
+		ids = Mat(1, centersMatrices.front().cols, CV_32S);
+		for(int i=0; i<ids.cols; ++i)
+			ids.at<int>(i) = i;
+	}
+
+	// Write the binary file
+	markerTrackWriter writer;
+	if (!writer.open(outputFilename, ids, corners.isOpened()))
+	{
+		cerr << "\nError opening " << outputFilename << " ! \n" << endl;
+		return -1;
+	}
+	for(int frame = 0; frame < frameCount; ++frame)
+		writer.write(centersMatrices.at(frame), cornersMatrices.at(frame));
+	writer.close();
+
+	// Read it back
+	start = chrono::steady_clock::now();
+	markerTrackReader reader;
+	if (!reader.open(outputFilename))
+		return -1;
+	double binaryTime = elapsedMs(start);
+
+	int different = 0;
+	for(int frame = 1; frame <= frameCount; ++frame)
+		if (!sameMatrix(reader.getCenters(frame), centersMatrices.at(frame-1))
+			|| (corners.isOpened() && !sameMatrix(reader.getCorners(frame), cornersMatrices.at(frame-1))))
+			different++;
+
+	cout << frameCount << " frames of " << ids.cols << " markers written in " << outputFilename << endl;
+	cout << "Loading time -- YAML : " << yamlTime << " ms -- Binary : " << binaryTime << " ms" << endl;
+	if (different > 0)
+	{
+		cerr << "\n" << different << " frames differ from the YAML files ! \n" << endl;
+		return -1;
+	}
+	return 0;
+}
+
+
+
+// Help function
+void help()
+{
+	cout
+	<< "\nUsage: ./program <centers file> [corners file] <marker track file>" << endl
+	<< "       ./program --translation <ground truth file> <track file>" << endl
+	<< "Examples: " << endl
+	<< "Centers only : ./program _markers_centers.yml _markers_centers.mkt" << endl
+	<< "Centers and corners : ./program centers.yml corners.yml markers.mkt" << endl
+	<< "Ground truth : ./program --translation camera_translation_data.yml camera_translation_data.mkt \n" << endl;
+}
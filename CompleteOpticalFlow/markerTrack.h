@@ -0,0 +1,171 @@
+#pragma once
+
+// Standard libraries
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+
+// Binary marker track file (.mkt), replaces the "frameN" nodes of centers.yml/corners.yml
+//
+//   header     markerTrackHeader, then the ids (int32), padded to dataOffset
+//   records    one per frame, all of recordSize bytes, frame f (from 1) at dataOffset + (f-1)*recordSize
+//                centers    float32 2 x markerCount, row major like the centers matrix
+//                corners    float32 8 x markerCount, only when hasCorners
+//                missing    1 bit per marker (bit i of byte i/8), set when the center is missing
+//
+// The missing markers keep their -1 coordinates so the matrices read back are the ones written.
+// A track of the ground truth translation holds a single "marker" whose center is the translation,
+// its missing bits only mean that the translation is negative and should not be used.
+// Each record only holds fixed-stride float columns, so a frame is found without any parsing
+// and appending a frame never moves the previous ones.
+// The header is written first, its frame count is updated at each checkpoint and finished is set
+// by close(). The readers of an unfinished file (crash, or still being written) take every
+// complete record after the header, a torn last record is left out.
+// The values are stored in the byte order of the machine (little endian on x86).
+
+uint32_t const MARKER_TRACK_VERSION = 1;
+uint32_t const MARKER_TRACK_CENTER_ROWS = 2;
+uint32_t const MARKER_TRACK_CORNER_ROWS = 8;
+
+struct markerTrackHeader
+{
+	char magic[8];				// "MKTRACK1"
+	uint32_t version;
+	uint32_t markerCount;
+	uint32_t hasCorners;
+	uint32_t recordSize;
+	uint64_t frameCount;
+	uint64_t dataOffset;
+	uint64_t finished;			// 0 until the writer is closed
+	uint64_t reserved;
+};
+
+
+// Layout of a record, shared by the readers and the writers
+struct markerTrackLayout
+{
+	int markerCount;
+	bool hasCorners;
+	size_t centersOffset;
+	size_t cornersOffset;
+	size_t missingOffset;
+	size_t recordSize;
+
+	markerTrackLayout(int markerCount = 0, bool hasCorners = true);
+	bool isMissing(const char *record, int marker) const;
+};
+
+bool readMarkerTrackHeader(const char *data, size_t size, markerTrackHeader &header, cv::Mat &ids);
+
+
+// Appends the frames on a background thread : write() only packs the record and queues it,
+// so the detection loop never waits for the disk. The thread hands every batch of records to the
+// system and rewrites the frame count of the header every checkpointFrames frames (no fsync, the
+// file survives a crash of the program, not of the machine).
+class markerTrackWriter
+{
+private:
+	std::ofstream file;
+	markerTrackHeader header;
+	markerTrackLayout layout;
+	std::vector<char> record;
+	int checkpointFrames;
+	int queuedFrames;
+
+	// Shared with the writer thread
+	std::mutex lock;
+	std::condition_variable wakeUp;
+	std::vector<char> pending;
+	bool stopping;
+	std::thread writer;
+
+	markerTrackWriter(const markerTrackWriter&) = delete;
+	markerTrackWriter &operator=(const markerTrackWriter&) = delete;
+
+	void writerLoop();
+	void writeHeader(uint64_t frameCount, bool finished);
+
+public:
+	markerTrackWriter();
+	~markerTrackWriter();
+
+	bool open(std::string filename, cv::Mat ids, bool hasCorners = true, int checkpointFrames = 30);
+	bool isOpened();
+	void write(cv::Mat centersMatrix, cv::Mat cornersMatrix = cv::Mat(), cv::Mat found = cv::Mat());
+	int getFrameCount();
+	void close();
+};
+
+
+// Loads the whole file with a single read, the matrices given back point in the loaded buffer
+class markerTrackReader
+{
+private:
+	std::vector<char> data;
+	markerTrackHeader header;
+	markerTrackLayout layout;
+	cv::Mat ids;
+
+public:
+	markerTrackReader();
+
+	bool open(std::string filename);
+	bool isOpened();
+	int getFrameCount();
+	int getMarkerCount();
+	bool hasCorners();
+	cv::Mat getIds();
+
+	// frame goes from 1 to getFrameCount() like the "frameN" nodes
+	cv::Mat getCenters(int frame);
+	cv::Mat getCorners(int frame);
+	bool isMissing(int frame, int marker);
+};
+
+
+// Maps the file in memory instead of loading it : opening is immediate whatever the length
+// of the video, only the pages of the frames that are used are read, and any frame is reached
+// in O(1). The matrices given back are read-only views of the mapping, valid until close(),
+// clone() them before modifying them.
+class markerTrackMapping
+{
+private:
+	int fd;
+	const char *data;
+	size_t size;
+	markerTrackHeader header;
+	markerTrackLayout layout;
+	cv::Mat ids;
+
+	markerTrackMapping(const markerTrackMapping&) = delete;
+	markerTrackMapping &operator=(const markerTrackMapping&) = delete;
+
+	const char *record(int frame);
+
+public:
+	markerTrackMapping();
+	~markerTrackMapping();
+
+	bool open(std::string filename);
+	void close();
+	bool isOpened();
+	int getFrameCount();
+	int getMarkerCount();
+	bool hasCorners();
+	cv::Mat getIds();
+
+	// frame goes from 1 to getFrameCount() like the "frameN" nodes
+	cv::Mat getCenters(int frame);
+	cv::Mat getCorners(int frame);
+	bool isMissing(int frame, int marker);
+};
@@ -173,13 +173,27 @@ void markersDetector::createMarkersFiles(std::string markersCenterFilename, std:
 }
 
 
+// Create the binary track file, written alongside or instead of the yml files
+void markersDetector::createMarkersTrack(std::string markersTrackFilename)
+{
+	if (!markersTrack.open(markersTrackFilename, ids, true))
+		std::cerr << "\nFailed to create " << markersTrackFilename << " ! \n" << std::endl;
+}
+
+
 // Write the value of the marker in a file
 void markersDetector::writeMarkersFiles()
 {
-	std::stringstream frameNumber;
-	frameNumber << "frame" << frameCount;
-	markersCenters << frameNumber.str() << centersMatrix;
-	markersCorners << frameNumber.str() << cornersMatrix;
+	if (markersCenters.isOpened())
+	{
+		std::stringstream frameNumber;
+		frameNumber << "frame" << frameCount;
+		markersCenters << frameNumber.str() << centersMatrix;
+		markersCorners << frameNumber.str() << cornersMatrix;
+	}
+	
+	if (markersTrack.isOpened())
+		markersTrack.write(centersMatrix, cornersMatrix);
 }
 
 // Read the value of the marker in a file
@@ -194,14 +208,38 @@ void markersDetector::readMarkersFiles(cv::FileStorage markersCenters, cv::FileS
 }
 
 
+// Read the value of the marker in the binary track file
+// The matrices are copied since setMarkersPosition modifies them
+void markersDetector::readMarkersTrack(markerTrackReader &markersTrack)
+{
+	markersTrack.getCenters(frameCount).copyTo(centersMatrix);
+	
+	if (markersTrack.hasCorners())
+		markersTrack.getCorners(frameCount).copyTo(cornersMatrix);
+}
+
+void markersDetector::readMarkersTrack(markerTrackMapping &markersTrack)
+{
+	markersTrack.getCenters(frameCount).copyTo(centersMatrix);
+	
+	if (markersTrack.hasCorners())
+		markersTrack.getCorners(frameCount).copyTo(cornersMatrix);
+}
+
+
 // Close the file where the marker are stored
 void  markersDetector::closeMarkersFiles()
 {
-	markersCenters << "frameCount" << frameCount-1;
-	markersCorners << "frameCount" << frameCount-1;
+	if (markersCenters.isOpened())
+	{
+		markersCenters << "frameCount" << frameCount-1;
+		markersCorners << "frameCount" << frameCount-1;
+		
+		markersCenters.release();
+		markersCorners.release();
+	}
 	
-	markersCenters.release();
-	markersCorners.release();
+	markersTrack.close();
 }
 
 
@@ -13,6 +13,9 @@
 #include <aruco/aruco.h>
 #include <aruco/cvdrawingutils.h>
 
+// Others
+#include "markerTrack.h"
+
 
 class markersDetector
 {
@@ -28,6 +31,7 @@ private:
 	
 	cv::FileStorage markersCenters;
 	cv::FileStorage markersCorners;
+	markerTrackWriter markersTrack;
 	
 public:
 	markersDetector(float thresholdX = 4., float thresholdY = 4., cv::Mat ids = (cv::Mat_<int> (1,10) <<10,20,30,40,50,60,70,80,90,100));
@@ -46,6 +50,9 @@ public:
 	
 	void createMarkersFiles(std::string markersCenterFilename = "centers.yml" , std::string markersCornersFilename = "corners.yml");
 	void readMarkersFiles(cv::FileStorage markersCenters, cv::FileStorage markersCorners = NULL);
+	void createMarkersTrack(std::string markersTrackFilename = "markers.mkt");
+	void readMarkersTrack(markerTrackReader &markersTrack);
+	void readMarkersTrack(markerTrackMapping &markersTrack);
 	void writeMarkersFiles();
 	void closeMarkersFiles();
 	int newFrame();
@@ -0,0 +1,117 @@
+// Standard libraries
+#include <iostream>
+#include <vector>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+// Header
+#include "markersMask.h"
+
+// Global variables
+const int BACKGROUND_VALUE = 225;
+const int MARKER_VALUE = 0;
+const int EXTRA_THICKNESS = 25;
+
+
+// Constructor
+markersMask::markersMask(int height, int width, int maskSize)
+{
+	this->maskSize = maskSize;
+	mask = cv::Mat(height,width, CV_8UC1,cv::Scalar::all(BACKGROUND_VALUE));
+}
+
+
+// Box covered by the marker i, the same area as the thick contour drawn by maskUpdate
+cv::Rect markersMask::markerBox(cv::Mat matrix, int i)
+{
+	if(matrix.at<float>(0,i)<0 || matrix.at<float>(1,i)<0)
+		return cv::Rect();
+
+	float minX, maxX, minY, maxY;
+	int thickness;
+
+	if (maskSize < 0)
+	{
+		// The matrix holds the 4 corners of the markers
+		minX = maxX = matrix.at<float>(0,i);
+		minY = maxY = matrix.at<float>(1,i);
+		for(int j=1; j<(int) matrix.rows/2 ; j++)
+		{
+			minX = std::min(minX, matrix.at<float>((2*j),i));
+			maxX = std::max(maxX, matrix.at<float>((2*j),i));
+			minY = std::min(minY, matrix.at<float>((2*j)+1,i));
+			maxY = std::max(maxY, matrix.at<float>((2*j)+1,i));
+		}
+		thickness = std::max(std::abs((int) matrix.at<float>(0,i) - (int) matrix.at<float>(2,i)),
+							 std::abs((int) matrix.at<float>(1,i) - (int) matrix.at<float>(5,i)))+EXTRA_THICKNESS;
+	}
+
+	else
+	{
+		// The matrix holds the centers, the marker is a square of half side maskSize
+		minX = matrix.at<float>(0,i) - maskSize;
+		maxX = matrix.at<float>(0,i) + maskSize;
+		minY = matrix.at<float>(1,i) - maskSize;
+		maxY = matrix.at<float>(1,i) + maskSize;
+		thickness = 2*maskSize + EXTRA_THICKNESS;
+	}
+
+	int border = (thickness+1)/2;
+	cv::Rect box(cv::Point((int) minX - border, (int) minY - border), cv::Point((int) maxX + border + 1, (int) maxY + border + 1));
+	return box & cv::Rect(0, 0, mask.cols, mask.rows);
+}
+
+
+// Move the markers to their new position and return the mask
+cv::Mat markersMask::update(cv::Mat matrix)
+{
+	newBoxes.assign(std::max((int) boxes.size(), matrix.cols), cv::Rect());
+	boxes.resize(newBoxes.size());
+	cleared.clear();
+
+	// Give back to the background the old boxes of the markers that moved
+	for(int i=0; i<newBoxes.size(); ++i)
+	{
+		if (i < matrix.cols)
+			newBoxes.at(i) = markerBox(matrix, i);
+
+		if (newBoxes.at(i) != boxes.at(i) && boxes.at(i).area() > 0)
+		{
+			mask(boxes.at(i)).setTo(cv::Scalar::all(BACKGROUND_VALUE));
+			cleared.push_back(boxes.at(i));
+		}
+	}
+
+	// Stamp the new boxes, and the boxes that did not move but were partly cleared
+	for(int i=0; i<newBoxes.size(); ++i)
+	{
+		if (newBoxes.at(i).area() == 0)
+			continue;
+
+		bool stamp = newBoxes.at(i) != boxes.at(i);
+		for(int j=0; j<cleared.size() && !stamp; ++j)
+			stamp = (newBoxes.at(i) & cleared.at(j)).area() > 0;
+
+		if (stamp)
+			mask(newBoxes.at(i)).setTo(cv::Scalar::all(MARKER_VALUE));
+	}
+
+	boxes.swap(newBoxes);
+	return mask;
+}
+
+
+cv::Mat markersMask::getMask()
+{
+	return mask;
+}
+
+
+// Remove all the markers from the mask
+void markersMask::reset()
+{
+	mask.setTo(cv::Scalar::all(BACKGROUND_VALUE));
+	boxes.clear();
+}
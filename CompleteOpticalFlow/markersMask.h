@@ -0,0 +1,32 @@
+#pragma once
+
+// Standard libraries
+#include <iostream>
+#include <vector>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+
+// Mask that hides the markers from the feature detector.
+// The mask is kept from one frame to the next and only the boxes of the markers
+// that moved are cleared and stamped again.
+class markersMask
+{
+private:
+	cv::Mat mask;
+	int maskSize;
+	std::vector<cv::Rect> boxes;
+	std::vector<cv::Rect> newBoxes;
+	std::vector<cv::Rect> cleared;
+
+	cv::Rect markerBox(cv::Mat matrix, int i);
+
+public:
+	markersMask(int height, int width, int maskSize = -1);
+
+	cv::Mat update(cv::Mat matrix);
+	cv::Mat getMask();
+	void reset();
+};
@@ -16,6 +16,11 @@
 
 
 
+// Parametres of the detectors and of the grid detection
+int const GRID_MARGIN = 16;
+int const FAST_THRESHOLD = 30;
+
+
 void initFeatureDetector(cv::Ptr<cv::FeatureDetector> &detector , std::string detectorName)
 {
 	// From the faster to the slower detector
@@ -23,7 +28,7 @@ void initFeatureDetector(cv::Ptr<cv::FeatureDetector> &detector , std::string de
 	if (detectorName == "FAST")
 	{
 		detector= new cv::FastFeatureDetector();
-		detector->set("threshold", 30);
+		detector->set("threshold", FAST_THRESHOLD);
 		detector->set("nonmaxSuppression",true);
 	}
 	
@@ -84,6 +89,68 @@ void initFeatureDetector(cv::Ptr<cv::FeatureDetector> &detector , std::string de
 
 
 
+// Detection of the features in the cells of the grid, the cells are independent and run in parallel
+class cellDetection : public cv::ParallelLoopBody
+{
+private:
+	cv::Mat frame;
+	cv::Mat mask;
+	int rows;
+	int cols;
+	int quota;
+	bool adaptThreshold;
+	std::vector<cv::Ptr<cv::FeatureDetector> > &detectors;
+	std::vector<thresholdController> &thresholds;
+	std::vector<std::vector<cv::KeyPoint> > &cellKeypoints;
+	
+public:
+	cellDetection(cv::Mat frame, cv::Mat mask, int rows, int cols, int quota, bool adaptThreshold,
+				  std::vector<cv::Ptr<cv::FeatureDetector> > &detectors, std::vector<thresholdController> &thresholds,
+				  std::vector<std::vector<cv::KeyPoint> > &cellKeypoints)
+		: frame(frame), mask(mask), rows(rows), cols(cols), quota(quota), adaptThreshold(adaptThreshold),
+		  detectors(detectors), thresholds(thresholds), cellKeypoints(cellKeypoints) {}
+	
+	void operator()(const cv::Range &range) const
+	{
+		for(int i=range.start; i<range.end; ++i)
+		{
+			int r = i/cols;
+			int c = i%cols;
+			cv::Rect cell(cv::Point(c*frame.cols/cols, r*frame.rows/rows), cv::Point((c+1)*frame.cols/cols, (r+1)*frame.rows/rows));
+			
+			// The detectors ignore the borders of the image, so the cell is enlarged a little
+			cv::Rect roi(cell.x-GRID_MARGIN, cell.y-GRID_MARGIN, cell.width+2*GRID_MARGIN, cell.height+2*GRID_MARGIN);
+			roi &= cv::Rect(0, 0, frame.cols, frame.rows);
+			
+			std::vector<cv::KeyPoint> &kpt = cellKeypoints[i];
+			if (adaptThreshold)
+				detectors[i]->set("threshold", thresholds[i].getThreshold());
+			detectors[i]->detect(frame(roi), kpt, mask.empty() ? cv::Mat() : mask(roi));
+			
+			// Keep the keypoints of the cell only, in frame coordinates
+			int kept = 0;
+			for(int j=0; j<kpt.size(); ++j)
+			{
+				cv::Point2f p = kpt[j].pt + cv::Point2f(roi.x, roi.y);
+				if (p.x >= cell.x && p.y >= cell.y && p.x < cell.x+cell.width && p.y < cell.y+cell.height)
+				{
+					kpt[kept] = kpt[j];
+					kpt[kept].pt = p;
+					kept++;
+				}
+			}
+			kpt.resize(kept);
+			
+			// Textured cells raise their threshold, flat cells lower it
+			if (adaptThreshold)
+				thresholds[i].update(kept, quota, 2*quota);
+			
+			cv::KeyPointsFilter::retainBest(kpt, quota);
+		}
+	}
+};
+
+
 // Update of the mask of the markers at each frame
 void maskUpdate(cv::Mat cornersMatrix, cv::Mat &mask )
 {
@@ -123,14 +190,119 @@ void maskUpdate(cv::Mat centersMatrix, cv::Mat &mask, int mask_size )
 
 
 // Clean the feature according to their correspondance	
-std::vector<cv::Point2f> cleanFeatures(std::vector<cv::Point2f> kpt, std::vector<uchar> status)
+// The pairs are compacted in place and keep their order, the buffers never grow
+void cleanFeatures(std::vector<cv::Point2f> &kptPrev, std::vector<cv::Point2f> &kptNext, std::vector<float> &err, const std::vector<uchar> &status)
+{
+	int kept = 0;
+	for(int i=0 ; i < status.size(); ++i)
+		if(status[i] == 1)
+		{
+			kptPrev[kept] = kptPrev[i];
+			kptNext[kept] = kptNext[i];
+			err[kept] = err[i];
+			kept++;
+		}
+	
+	kptPrev.resize(kept);
+	kptNext.resize(kept);
+	err.resize(kept);
+}
+
+
+// Reject the points whose forward-backward round trip ends further than threshold from where it started
+// The squared distances are computed 4 points at a time
+void forwardBackwardCheck(const std::vector<cv::Point2f> &kptPrev, const std::vector<cv::Point2f> &kptBack, std::vector<uchar> &status, const std::vector<uchar> &statusBack, float threshold)
+{
+	int n = (int) kptPrev.size();
+	float threshold2 = threshold*threshold;
+	int i = 0;
+	
+	if (n == 0)
+		return;
+	
+	const float *prev = &kptPrev[0].x;
+	const float *back = &kptBack[0].x;
+	
+#if defined(__SSE2__)
+	__m128 th = _mm_set1_ps(threshold2);
+	for( ; i+4 <= n; i+=4)
+	{
+		// (x0,y0,x1,y1) and (x2,y2,x3,y3)
+		__m128 d0 = _mm_sub_ps(_mm_loadu_ps(prev+2*i), _mm_loadu_ps(back+2*i));
+		__m128 d1 = _mm_sub_ps(_mm_loadu_ps(prev+2*i+4), _mm_loadu_ps(back+2*i+4));
+		d0 = _mm_mul_ps(d0,d0);
+		d1 = _mm_mul_ps(d1,d1);
+		
+		// dx² + dy² for the 4 points
+		__m128 dist = _mm_add_ps(_mm_shuffle_ps(d0, d1, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(d0, d1, _MM_SHUFFLE(3,1,3,1)));
+		int inliers = _mm_movemask_ps(_mm_cmple_ps(dist, th));
+		
+		for(int j=0; j<4; ++j)
+			status[i+j] = status[i+j] && statusBack[i+j] && ((inliers >> j) & 1);
+	}
+#endif
+	
+	for( ; i < n; ++i)
+	{
+		float dx = prev[2*i] - back[2*i];
+		float dy = prev[2*i+1] - back[2*i+1];
+		status[i] = status[i] && statusBack[i] && (dx*dx + dy*dy <= threshold2);
+	}
+}
+
+
+// Displacement of the pixels of row y under the homography h (row major)
+// Along the row the numerators and the denominator only grow by the first column of h, so they
+// are incremented 4 pixels at a time; they are recomputed in double every DISPLACEMENT_BLOCK
+// pixels so that the float increments do not drift
+int const DISPLACEMENT_BLOCK = 64;
+
+void displacementRow(const double h[9], int y, const float *gridX, float *deltaX, float *deltaY, int width)
 {
-	std::vector<cv::Point2f> kptclean;
-	for(int i=0 ; i < kpt.size(); ++i)
-		if(status.at(i) == 1)
-			kptclean.push_back(kpt.at(i));
+	double rowX = h[1]*y + h[2];
+	double rowY = h[4]*y + h[5];
+	double rowW = h[7]*y + h[8];
+	
+	for(int start = 0; start < width; start += DISPLACEMENT_BLOCK)
+	{
+		int end = std::min(width, start + DISPLACEMENT_BLOCK);
+		int x = start;
 		
-	return kptclean;
+#if defined(__SSE2__)
+		__m128 offsets = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+		__m128 X = _mm_add_ps(_mm_set1_ps(rowX + h[0]*x), _mm_mul_ps(offsets, _mm_set1_ps(h[0])));
+		__m128 Y = _mm_add_ps(_mm_set1_ps(rowY + h[3]*x), _mm_mul_ps(offsets, _mm_set1_ps(h[3])));
+		__m128 W = _mm_add_ps(_mm_set1_ps(rowW + h[6]*x), _mm_mul_ps(offsets, _mm_set1_ps(h[6])));
+		__m128 stepX = _mm_set1_ps(4*h[0]);
+		__m128 stepY = _mm_set1_ps(4*h[3]);
+		__m128 stepW = _mm_set1_ps(4*h[6]);
+		__m128 rowIndex = _mm_set1_ps(y);
+		__m128 one = _mm_set1_ps(1.f);
+		
+		for( ; x+4 <= end; x+=4)
+		{
+			__m128 w = _mm_div_ps(one, W);
+			_mm_storeu_ps(deltaX+x, _mm_sub_ps(_mm_mul_ps(X, w), _mm_loadu_ps(gridX+x)));
+			_mm_storeu_ps(deltaY+x, _mm_sub_ps(_mm_mul_ps(Y, w), rowIndex));
+			X = _mm_add_ps(X, stepX);
+			Y = _mm_add_ps(Y, stepY);
+			W = _mm_add_ps(W, stepW);
+		}
+#endif
+		
+		float X1 = rowX + h[0]*x;
+		float Y1 = rowY + h[3]*x;
+		float W1 = rowW + h[6]*x;
+		for( ; x < end; ++x)
+		{
+			float w = 1.f/W1;
+			deltaX[x] = X1*w - gridX[x];
+			deltaY[x] = Y1*w - y;
+			X1 += h[0];
+			Y1 += h[3];
+			W1 += h[6];
+		}
+	}
 }
 
 
@@ -161,54 +333,172 @@ opticalFlow::opticalFlow(std::string detectorName, int cornerBackgroundSize, int
 	
 	initFeatureDetector(detector , detectorName);
 	
+	// Buffers reused at each frame
+	kptPrev.reserve(2*bestPointToKeep);
+	kpt.reserve(2*bestPointToKeep);
+	kptNext.reserve(2*bestPointToKeep);
+	status.reserve(2*bestPointToKeep);
+	err.reserve(2*bestPointToKeep);
+	
+	// Default parametres of calcOpticalFlowPyrLK
+	winSize = cv::Size(21,21);
+	maxLevel = 3;
+	
+	forwardBackwardMode = false;
+	forwardBackwardThreshold = 1.;
+	
+	gridRows = 0;
+	gridCols = 0;
+	
+	// Only FAST exposes a threshold
+	adaptiveThreshold = (detectorName == "FAST");
+	fastThreshold = thresholdController(FAST_THRESHOLD);
+}
 
+
+// Detect the count best keypoints, on the whole frame or cell by cell
+// When adapt is true the number of keypoints found drives the threshold of the next frame
+void opticalFlow::detectKeyPoints(cv::Mat frame, cv::Mat mask, int count, bool adapt)
+{
+	adapt = adapt && adaptiveThreshold;
+	
+	if (gridRows <= 0 || gridCols <= 0)
+	{
+		if (adaptiveThreshold)
+			detector->set("threshold", fastThreshold.getThreshold());
+		detector->detect(frame, keypoints, mask);
+		if (adapt)
+			fastThreshold.update(keypoints.size(), count, 2*count);
+		cv::KeyPointsFilter::retainBest(keypoints,count);
+		return;
+	}
+	
+	int cells = gridRows*gridCols;
+	int quota = (count + cells-1)/cells;
+	cv::parallel_for_(cv::Range(0, cells), cellDetection(frame, mask, gridRows, gridCols, quota, adapt,
+														 cellDetectors, cellThresholds, cellKeypoints));
+	
+	keypoints.clear();
+	for(int i=0; i<cells; ++i)
+		keypoints.insert(keypoints.end(), cellKeypoints[i].begin(), cellKeypoints[i].end());
+	cv::KeyPointsFilter::retainBest(keypoints,count);
 }
 
 
 void opticalFlow::FeatureDetection(cv::Mat frame, cv::Mat mask)
 {
-	detector->detect(frame, keypoints, mask);
-	cv::KeyPointsFilter::retainBest(keypoints,bestPointToKeep);
+	detectKeyPoints(frame, mask, bestPointToKeep, true);
 	cv::KeyPoint::convert(keypoints, kptNext);
-	kpt = kptNext;
+	kpt.assign(kptNext.begin(), kptNext.end());
 	
 	if(kptPrev.empty())
-		kptPrev = kptNext;
+		kptPrev.assign(kptNext.begin(), kptNext.end());
 }
 
 
-void opticalFlow::findProjectiveMatrix(cv::Mat framePrev, cv::Mat frame, cv::Mat &homography)
+// Build the pyramid of the new frame, the one of the previous frame is reused when
+// framePrev is the frame given at the last call (same buffer, not modified since)
+void opticalFlow::buildPyramids(cv::Mat framePrev, cv::Mat frame)
+{
+	if (pyramidPrev.empty() || pyramidFrame.data != framePrev.data || pyramidFrame.size() != framePrev.size())
+		cv::buildOpticalFlowPyramid(framePrev, pyramidPrev, winSize, maxLevel);
+	else
+		pyramidPrev.swap(pyramidNext);
+	
+	cv::buildOpticalFlowPyramid(frame, pyramidNext, winSize, maxLevel);
+	
+	// Holding the header keeps the buffer alive, so its address cannot be given to another frame
+	pyramidFrame = frame;
+}
+
+
+// Track the features from framePrev to frame, only the matched pairs are kept
+void opticalFlow::trackFeatures(cv::Mat framePrev, cv::Mat frame)
 {
 	// Compute opticalflow
-		cv::calcOpticalFlowPyrLK(framePrev,frame,kptPrev,kptNext,status,err);
+		buildPyramids(framePrev, frame);
+		cv::calcOpticalFlowPyrLK(pyramidPrev,pyramidNext,kptPrev,kptNext,status,err,winSize,maxLevel);
 		
-		// Keep only the feature with status == 1
-		kptPrev = cleanFeatures(kptPrev,status);
-		kptNext = cleanFeatures(kptNext, status);
+		// Track the points back to the previous frame and drop the inconsistent ones
+		if (forwardBackwardMode && !kptNext.empty())
+		{
+			cv::calcOpticalFlowPyrLK(pyramidNext,pyramidPrev,kptNext,kptBack,statusBack,errBack,winSize,maxLevel);
+			forwardBackwardCheck(kptPrev, kptBack, status, statusBack, forwardBackwardThreshold);
+		}
 		
-		homography = cv::findHomography(kptPrev,kptNext,CV_RANSAC,3,hStatus);
+		// Keep only the feature with status == 1
+		cleanFeatures(kptPrev, kptNext, err, status);
+}
+
+
+// Copy of the last matched pairs, used to hand them to another thread
+// The given buffers keep their capacity. No more than bestPointToKeep points are tracked,
+// so a reused buffer is reallocated at most once
+void opticalFlow::getMatchedPoints(std::vector<cv::Point2f> &kptPrev, std::vector<cv::Point2f> &kptNext, std::vector<float> &err)
+{
+	kptPrev.reserve(bestPointToKeep);
+	kptNext.reserve(bestPointToKeep);
+	err.reserve(bestPointToKeep);
+	
+	kptPrev.assign(this->kptPrev.begin(), this->kptPrev.end());
+	kptNext.assign(this->kptNext.begin(), this->kptNext.end());
+	err.assign(this->err.begin(), this->err.end());
+}
+
+
+void opticalFlow::findProjectiveMatrix(cv::Mat framePrev, cv::Mat frame, cv::Mat &homography)
+{
+		trackFeatures(framePrev, frame);
+		if (!estimator.estimate(kptPrev,kptNext,err,homography,hStatus))
+		{
+			homography.release();
+			hStatus.release();
+		}
 }
 
 void opticalFlow::keyPointsUpdate(cv::Mat frame, cv::Mat mask)
 {
 	if( (float) kptNext.size()/bestPointToKeep < updateRate)
 	{
+		// kpt and kptNext are overwritten by the next detection, their buffers can be swapped
 		if (refreshAllMode)
-			kptPrev = kpt;
+			kptPrev.swap(kpt);
 		
 		else
 		{
-			kptPrev = kptNext;
-			detector->detect(frame, keypoints,mask);
-			cv::KeyPointsFilter::retainBest(keypoints,(int) bestPointToKeep*(1-updateRate));
+			kptPrev.swap(kptNext);
+			detectKeyPoints(frame, mask, (int) bestPointToKeep*(1-updateRate), false);
 			cv::KeyPoint::convert(keypoints, kpt);
 			kptPrev.insert(kptPrev.end(),kpt.begin(),kpt.end());
 		}
-		
-		std::cout<< "REFRESH ! " << std::endl;
 	}
 	else
-		kptPrev = kptNext;
+		kptPrev.swap(kptNext);
+}
+
+
+// Displacement of each pixel of a width x height frame under the homography
+// deltaX(y,x) = x'-x and deltaY(y,x) = y'-y where (x',y') is the projection of (x,y)
+void opticalFlow::pixelDisplacment(cv::Mat homography, cv::Mat &deltaX, cv::Mat &deltaY, int width, int height)
+{
+	double h[9];
+	for(int i=0; i<9; ++i)
+		h[i] = (homography.depth() == CV_32F) ? homography.at<float>(i/3,i%3) : homography.at<double>(i/3,i%3);
+	
+	// The base grid only changes with the size of the frames
+	if (gridX.cols != width)
+	{
+		gridX.create(1, width, CV_32F);
+		for(int x=0; x<width; ++x)
+			gridX.at<float>(x) = x;
+	}
+	
+	deltaX.create(height, width, CV_32F);
+	deltaY.create(height, width, CV_32F);
+	
+	const float *grid = gridX.ptr<float>(0);
+	for(int y=0; y<height; ++y)
+		displacementRow(h, y, grid, deltaX.ptr<float>(y), deltaY.ptr<float>(y), width);
 }
 
 
@@ -221,7 +511,84 @@ void opticalFlow::markersMaskUpdate(cv::Mat matrix , cv::Mat &mask)
 }
 
 
+int opticalFlow::getCornerBackgroundSize()
+{
+	return cornerBackgroundSize;
+}
+
+
+// Number of keypoints given by the last detection
+int opticalFlow::getKeypointsCount()
+{
+	return (int) kpt.size();
+}
+
+
+// The threshold is the maximal round trip error in pixels
+void opticalFlow::setForwardBackwardMode(bool mode, float threshold)
+{
+	forwardBackwardMode = mode;
+	forwardBackwardThreshold = threshold;
+	kptBack.reserve(2*bestPointToKeep);
+	statusBack.reserve(2*bestPointToKeep);
+	errBack.reserve(2*bestPointToKeep);
+}
+
+
+// Let the FAST threshold follow the number of keypoints, or keep it fixed
+void opticalFlow::setAdaptiveThreshold(bool adaptiveThreshold)
+{
+	this->adaptiveThreshold = adaptiveThreshold && (detectorName == "FAST");
+}
+
+
+// Change a parametre of the detector, e.g. "threshold" for FAST or "nFeatures" for ORB
+void opticalFlow::setDetectorParameter(std::string name, int value)
+{
+	detector->set(name, value);
+	
+	if (detectorName == "FAST" && name == "threshold")
+		fastThreshold = thresholdController(value);
+}
+
+
+// Only run the detector on the whole frame and return the number of keypoints found
+// Nothing is tracked nor kept, this is what the detector benchmark times
+int opticalFlow::FeatureDetectorOnly(cv::Mat frame)
+{
+	detector->detect(frame, keypoints);
+	return (int) keypoints.size();
+}
+
+
+// Split the frame in rows x cols cells that each give an equal share of the keypoints
+// A value <= 0 goes back to the detection on the whole frame
+void opticalFlow::setGridMode(int rows, int cols)
+{
+	gridRows = rows;
+	gridCols = cols;
+	cellDetectors.clear();
+	cellThresholds.clear();
+	cellKeypoints.clear();
+	
+	if (rows <= 0 || cols <= 0)
+		return;
+	
+	cellDetectors.resize(rows*cols);
+	for(int i=0; i<rows*cols; ++i)
+		initFeatureDetector(cellDetectors[i], detectorName);
+	cellThresholds.assign(rows*cols, thresholdController(fastThreshold.getThreshold()));
+	cellKeypoints.resize(rows*cols);
+}
+
+
 void opticalFlow::drawOpticalflowArrows (cv::Mat image, int scale, cv::Scalar color)
+{
+	drawOpticalflowArrows(image, kptPrev, kptNext, hStatus, scale, color);
+}
+
+
+void opticalFlow::drawOpticalflowArrows (cv::Mat image, const std::vector<cv::Point2f> &kptPrev, const std::vector<cv::Point2f> &kptNext, cv::Mat hStatus, int scale, cv::Scalar color)
 {
 	// Source : Stavens_opencv_optical_flow
 		for(int i = 0; i < hStatus.rows; i++)
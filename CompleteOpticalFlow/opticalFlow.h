@@ -12,6 +12,14 @@
 #include "opencv2/features2d/features2d.hpp"
 #include "opencv2/nonfree/nonfree.hpp"
 
+// Others
+#include "thresholdController.h"
+#include "homographyEstimator.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 class opticalFlow
 {
@@ -24,23 +32,63 @@ private:
 	bool refreshAllMode;
 	
 	cv::Ptr<cv::FeatureDetector> detector;
+	bool adaptiveThreshold;
+	thresholdController fastThreshold;
 	
 	std::vector<cv::KeyPoint> keypoints;
 	std::vector<cv::Point2f> kptPrev,kpt,kptNext;
 	std::vector<uchar> status; 
 	cv::Mat hStatus;
 	std::vector<float> err;
+	homographyEstimator estimator;
+	
+	// Pyramids of the last tracked frames, each frame pyramid is built only once
+	cv::Size winSize;
+	int maxLevel;
+	cv::Mat pyramidFrame;
+	std::vector<cv::Mat> pyramidPrev, pyramidNext;
+	
+	// Forward-backward consistency check
+	bool forwardBackwardMode;
+	float forwardBackwardThreshold;
+	std::vector<cv::Point2f> kptBack;
+	std::vector<uchar> statusBack;
+	std::vector<float> errBack;
+	
+	// Grid detection : one detector and one threshold per cell
+	int gridRows;
+	int gridCols;
+	std::vector<cv::Ptr<cv::FeatureDetector> > cellDetectors;
+	std::vector<thresholdController> cellThresholds;
+	std::vector<std::vector<cv::KeyPoint> > cellKeypoints;
+	
+	// x coordinates of a row, kept from one frame to the next
+	cv::Mat gridX;
+	
+	void buildPyramids(cv::Mat framePrev, cv::Mat frame);
+	void detectKeyPoints(cv::Mat frame, cv::Mat mask, int count, bool adapt);
 	
 public:
 	opticalFlow(std::string detectorName , int cornerBackgroundSize =-1 ,int bestPointToKeep = 200 , float updateRate = 0.86 , bool refreshAllMode = true);
 	
 	void drawOpticalflowArrows (cv::Mat image, int scale= 7, cv::Scalar color=CV_RGB(255,0,0));
+	static void drawOpticalflowArrows (cv::Mat image, const std::vector<cv::Point2f> &kptPrev, const std::vector<cv::Point2f> &kptNext, cv::Mat hStatus, int scale= 7, cv::Scalar color=CV_RGB(255,0,0));
 	void drawDots(cv::Mat centersMatrix, cv::Mat &image, cv::Scalar color = cv::Scalar(0,200,0) , int thickness = 15);
 	
 	void markersMaskUpdate(cv::Mat matrix , cv::Mat &mask);
+	int getCornerBackgroundSize();
+	int getKeypointsCount();
+	void setForwardBackwardMode(bool mode, float threshold = 1.);
+	void setGridMode(int rows, int cols);
+	void setAdaptiveThreshold(bool adaptiveThreshold);
+	void setDetectorParameter(std::string name, int value);
+	int FeatureDetectorOnly(cv::Mat frame);
 	void FeatureDetection(cv::Mat frame , cv::Mat mask);
+	void trackFeatures(cv::Mat framePrev, cv::Mat frame);
+	void getMatchedPoints(std::vector<cv::Point2f> &kptPrev, std::vector<cv::Point2f> &kptNext, std::vector<float> &err);
 	void findProjectiveMatrix(cv::Mat framePrev, cv::Mat frame, cv::Mat &homography);
 	void keyPointsUpdate(cv::Mat frame, cv::Mat mask);
+	void pixelDisplacment(cv::Mat homography, cv::Mat &deltaX, cv::Mat &deltaY, int width, int height);
 	
 	float rmsError(cv::Mat coordinate1 , cv::Mat coordinate2);
 	
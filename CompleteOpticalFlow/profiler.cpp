@@ -0,0 +1,233 @@
+// Standard libraries
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+// Header
+#include "profiler.h"
+
+// Global variables
+int const HISTOGRAM_WIDTH = 40;
+
+
+// Names of the stages and counters of every thread that recorded something
+// The counters are never freed, a thread that ends still counts in the summary
+struct profilerRegistry
+{
+	std::mutex lock;
+	std::vector<std::string> names;
+	std::vector<profiler::threadTimes*> threads;
+
+	profilerRegistry()
+	{
+		const char *predefined[STAGE_PREDEFINED] = {"capture", "gray", "mask", "detect", "LK", "RANSAC", "tracking", "output"};
+		names.assign(predefined, predefined + STAGE_PREDEFINED);
+	}
+};
+
+profilerRegistry &registry()
+{
+	static profilerRegistry instance;
+	return instance;
+}
+
+
+void clearTimes(profiler::stageTimes &times)
+{
+	times.count.store(0, std::memory_order_relaxed);
+	times.total.store(0, std::memory_order_relaxed);
+	times.min.store(UINT64_MAX, std::memory_order_relaxed);
+	times.max.store(0, std::memory_order_relaxed);
+	for(int k=0; k<profiler::HISTOGRAM_BINS; ++k)
+		times.bins[k].store(0, std::memory_order_relaxed);
+}
+
+
+// Only the owner thread writes in its counters, a load and a store are enough
+inline void add(std::atomic<uint64_t> &counter, uint64_t value)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+
+// Counters of the calling thread, registered at its first use
+profiler::threadTimes &profiler::local()
+{
+	static thread_local threadTimes *times = NULL;
+	if (times == NULL)
+	{
+		times = new threadTimes;
+		for(int s=0; s<MAX_STAGES; ++s)
+			clearTimes(times->stages[s]);
+
+		profilerRegistry &r = registry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		r.threads.push_back(times);
+	}
+	return *times;
+}
+
+
+// Index of the stage called name, created if needed, -1 when there is no room left
+int profiler::stage(const std::string &name)
+{
+	profilerRegistry &r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+
+	std::vector<std::string>::iterator it = std::find(r.names.begin(), r.names.end(), name);
+	if (it != r.names.end())
+		return (int) (it - r.names.begin());
+
+	if (r.names.size() >= MAX_STAGES)
+		return -1;
+	r.names.push_back(name);
+	return (int) r.names.size()-1;
+}
+
+
+std::string profiler::stageName(int stage)
+{
+	profilerRegistry &r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	if (stage < 0 || stage >= r.names.size())
+		return "unknown";
+	return r.names.at(stage);
+}
+
+
+void profiler::record(int stage, std::chrono::steady_clock::duration elapsed)
+{
+	if (stage < 0 || stage >= MAX_STAGES)
+		return;
+
+	uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	stageTimes &times = local().stages[stage];
+
+	add(times.count, 1);
+	add(times.total, ns);
+	if (ns < times.min.load(std::memory_order_relaxed))
+		times.min.store(ns, std::memory_order_relaxed);
+	if (ns > times.max.load(std::memory_order_relaxed))
+		times.max.store(ns, std::memory_order_relaxed);
+
+	int bin = 0;
+	for(uint64_t us = ns/1000; us > 0 && bin < HISTOGRAM_BINS-1; us >>= 1)
+		bin++;
+	add(times.bins[bin], 1);
+}
+
+
+// Time spent in the stage by all the threads, in seconds
+double profiler::totalTime(int stage)
+{
+	if (stage < 0 || stage >= MAX_STAGES)
+		return 0;
+
+	profilerRegistry &r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	uint64_t total = 0;
+	for(int t=0; t<r.threads.size(); ++t)
+		total += r.threads.at(t)->stages[stage].total.load(std::memory_order_relaxed);
+	return total*1e-9;
+}
+
+
+uint64_t profiler::count(int stage)
+{
+	if (stage < 0 || stage >= MAX_STAGES)
+		return 0;
+
+	profilerRegistry &r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	uint64_t count = 0;
+	for(int t=0; t<r.threads.size(); ++t)
+		count += r.threads.at(t)->stages[stage].count.load(std::memory_order_relaxed);
+	return count;
+}
+
+
+// Upper bound (ms) of the bin that holds the p-th percentile, the summary caps it at the maximum
+double binPercentile(const uint64_t bins[], uint64_t count, double p)
+{
+	uint64_t rank = (uint64_t) (p/100.*count);
+	uint64_t seen = 0;
+	for(int k=0; k<profiler::HISTOGRAM_BINS; ++k)
+	{
+		seen += bins[k];
+		if (seen > rank)
+			return (1 << k)*1e-3;
+	}
+	return (1 << (profiler::HISTOGRAM_BINS-1))*1e-3;
+}
+
+
+// One line per stage, then the histogram of the durations of each stage
+void profiler::summary(std::ostream &out, bool histogram)
+{
+	profilerRegistry &r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+
+	out << std::endl << std::left << std::setw(16) << "Stage" << std::right
+		<< std::setw(10) << "Calls" << std::setw(8) << "Threads" << std::setw(12) << "Total ms" << std::setw(10) << "Mean ms"
+		<< std::setw(10) << "Min ms" << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms" << std::setw(10) << "Max ms" << std::endl;
+
+	for(int s=0; s<r.names.size(); ++s)
+	{
+		uint64_t count = 0, total = 0, min = UINT64_MAX, max = 0;
+		uint64_t bins[HISTOGRAM_BINS] = {};
+		int threads = 0;
+		for(int t=0; t<r.threads.size(); ++t)
+		{
+			stageTimes &times = r.threads.at(t)->stages[s];
+			uint64_t c = times.count.load(std::memory_order_relaxed);
+			if (c == 0)
+				continue;
+			threads++;
+			count += c;
+			total += times.total.load(std::memory_order_relaxed);
+			min = std::min(min, times.min.load(std::memory_order_relaxed));
+			max = std::max(max, times.max.load(std::memory_order_relaxed));
+			for(int k=0; k<HISTOGRAM_BINS; ++k)
+				bins[k] += times.bins[k].load(std::memory_order_relaxed);
+		}
+		if (count == 0)
+			continue;
+
+		out << std::left << std::setw(16) << r.names.at(s) << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(10) << count << std::setw(8) << threads << std::setw(12) << total*1e-6 << std::setw(10) << total*1e-6/count
+			<< std::setw(10) << min*1e-6 << std::setw(10) << std::min(binPercentile(bins, count, 50), max*1e-6)
+			<< std::setw(10) << std::min(binPercentile(bins, count, 95), max*1e-6)
+			<< std::setw(10) << max*1e-6 << std::endl;
+
+		if (!histogram)
+			continue;
+
+		uint64_t highest = *std::max_element(bins, bins + HISTOGRAM_BINS);
+		int first = 0, last = HISTOGRAM_BINS-1;
+		while (bins[first] == 0)
+			first++;
+		while (bins[last] == 0)
+			last--;
+		for(int k=first; k<=last; ++k)
+			out << "    < " << std::setw(10) << (1 << k)*1e-3 << " ms " << std::setw(8) << bins[k] << " "
+				<< std::string((size_t) (HISTOGRAM_WIDTH*bins[k]/highest), '#') << std::endl;
+	}
+	out.unsetf(std::ios::fixed);
+	out << std::setprecision(6);
+}
+
+
+// Clear every counter, no zone should be open at that time
+void profiler::reset()
+{
+	profilerRegistry &r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+	for(int t=0; t<r.threads.size(); ++t)
+		for(int s=0; s<MAX_STAGES; ++s)
+			clearTimes(r.threads.at(t)->stages[s]);
+}
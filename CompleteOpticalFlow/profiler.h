@@ -0,0 +1,85 @@
+#pragma once
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+// Others
+#include "traceRecorder.h"
+
+
+// Stages of the programs, other stages can be added at run time with profiler::stage()
+enum profilerStage
+{
+	STAGE_CAPTURE,
+	STAGE_GRAY,
+	STAGE_MASK,
+	STAGE_DETECT,
+	STAGE_LK,
+	STAGE_RANSAC,
+	STAGE_TRACKING,
+	STAGE_OUTPUT,
+	STAGE_PREDEFINED
+};
+
+
+// Accumulates the time spent in each stage with steady_clock.
+// Every thread writes in its own counters, only the registration of a new thread takes a lock,
+// so timing a zone costs two clock reads and a few relaxed atomic stores.
+// The summary adds the counters of all the threads, including the ones that already ended.
+class profiler
+{
+public:
+	static const int MAX_STAGES = 32;
+	static const int HISTOGRAM_BINS = 24;	// Bin k holds the durations in [2^(k-1), 2^k[ microseconds
+
+	struct stageTimes
+	{
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> total;		// nanoseconds
+		std::atomic<uint64_t> min;
+		std::atomic<uint64_t> max;
+		std::atomic<uint64_t> bins[HISTOGRAM_BINS];
+	};
+
+	struct threadTimes
+	{
+		stageTimes stages[MAX_STAGES];
+	};
+
+	static int stage(const std::string &name);
+	static std::string stageName(int stage);
+	static void record(int stage, std::chrono::steady_clock::duration elapsed);
+
+	static double totalTime(int stage);
+	static uint64_t count(int stage);
+	static void summary(std::ostream &out = std::cout, bool histogram = true);
+	static void reset();
+
+private:
+	static threadTimes &local();
+};
+
+
+// Times its own scope : { scopedZone zone(STAGE_DETECT); ... }
+// The zone also goes to the timeline when the traceRecorder is running
+class scopedZone
+{
+private:
+	int stage;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	explicit scopedZone(int stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+	~scopedZone()
+	{
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		profiler::record(stage, end - start);
+		if (traceRecorder::enabled())
+			traceRecorder::record(stage, start, end);
+	}
+};
@@ -0,0 +1,45 @@
+// Standard libraries
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+
+// Header
+#include "thresholdController.h"
+
+
+// Constructor
+thresholdController::thresholdController(int threshold, int minThreshold, int maxThreshold, float gain, int maxStep)
+{
+	this->threshold = threshold;
+	this->minThreshold = minThreshold;
+	this->maxThreshold = maxThreshold;
+	this->gain = gain;
+	this->maxStep = maxStep;
+}
+
+
+// Update the threshold from the number of keypoints found with the current one
+// The number of FAST corners drops roughly exponentially with the threshold, so the
+// step is proportional to the log of the ratio between the count and the middle of the band
+int thresholdController::update(int count, int low, int high)
+{
+	if (count >= low && count <= high)
+		return threshold;
+	
+	float target = 0.5*(low+high);
+	int step = (int) std::floor(gain*std::log(std::max(count,1)/target) + 0.5);
+	
+	// At least one step when out of the band, and not too much at once
+	if (step == 0)
+		step = (count < low) ? -1 : 1;
+	step = std::max(-maxStep, std::min(maxStep, step));
+	
+	threshold = std::max(minThreshold, std::min(maxThreshold, threshold+step));
+	return threshold;
+}
+
+
+int thresholdController::getThreshold()
+{
+	return threshold;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Standard libraries
+#include <iostream>
+#include <math.h>
+
+
+// Closed loop control of a detector threshold (FAST)
+// The threshold moves so that the number of keypoints of the next frame falls in a target band
+class thresholdController
+{
+private:
+	int threshold;
+	int minThreshold;
+	int maxThreshold;
+	float gain;
+	int maxStep;
+	
+public:
+	thresholdController(int threshold = 30, int minThreshold = 5, int maxThreshold = 120, float gain = 4., int maxStep = 8);
+	
+	int update(int count, int low, int high);
+	int getThreshold();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+
+// One timed zone of the trace
+struct traceEvent
+{
+	int stage;
+	int thread;
+	int frame;
+	int keypoints;
+	int tracks;
+	int64_t begin;		// nanoseconds since the start of the trace
+	int64_t end;
+
+	traceEvent() : stage(-1), thread(0), frame(-1), keypoints(-1), tracks(-1), begin(0), end(0) {}
+};
+
+
+// Timeline of the zones timed by scopedZone, written as a Chrome trace JSON file
+// (chrome://tracing or ui.perfetto.dev).
+// Each thread pushes its events in its own lock-free ring, a writer thread drains the rings
+// and formats the JSON, so the timed threads never touch the file. When a ring is full the
+// event is dropped and counted. frame, keypoints and tracks are set by each thread and
+// attached to the events it records afterwards.
+// scopedZone feeds the recorder, nothing is recorded between stop() and start().
+class traceRecorder
+{
+public:
+	static bool start(const std::string &filename, int bufferSize = 16384);
+	static void stop();
+	static bool enabled();
+
+	static void record(int stage, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+	static void setThreadName(const std::string &name);
+	static void setFrame(int frame);
+	static void setKeypoints(int keypoints);
+	static void setTracks(int tracks);
+};
@@ -8,20 +8,23 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/features2d/features2d.hpp>
 
+// Others
+#include "kalman.h"
+
 
 class trackingFilter
 {
 private:
 	int missingData;
 	
-	cv::KalmanFilter KF;
+	positionKalman KF;
 	float dt;
 	float dv;
 
 public:
 	trackingFilter (float x, float y, float velocityFactor = 1, float accelerationFactor = -1, int maxMissingData = 20);
-	cv::Mat applyFilter(float x, float y);
-	cv::Mat updateRelativePosition(float x, float y,float relativeX, float relativeY, float &deltaX, float &deltaY);
+	cv::Point2f applyFilter(float x, float y);
+	cv::Point2f updateRelativePosition(float x, float y,float relativeX, float relativeY, float &deltaX, float &deltaY);
 };
 
 
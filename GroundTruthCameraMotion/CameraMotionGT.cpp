@@ -12,6 +12,12 @@
  * 3. Use << MarkerDataFilter >> on the output YAML files of << MarkersDetector >> 
  * 4. Use << CameraMotion >> with the output YAML files of << MarkerDataFilter >>
  * 
+ * The markers are read from _markers_centers.mkt, or _markers_centers.yml when there is no track.
+ * The four ground truths are one "marker" tracks (see MarkerTrack.h) written frame by frame on
+ * background threads : camera_translation_data.mkt, camera_affine_data.mkt,
+ * camera_projective_data.mkt and foreground_translation_data.mkt. Frame 1 and the frames
+ * without ground truth hold -1.
+ * 
  * 
  * Note:
  * If the program crashes during execution, consider modifying the global parametres
@@ -34,7 +40,8 @@
 
 // Others
 #include "OutputControl.h"
-#include "TicToc.h"
+#include "Profiler.h"
+#include "MarkerTrack.h"
 
 // Namespaces
 using namespace cv;
@@ -117,6 +124,31 @@ Mat findTranslation(vector<Point2f>  keypoints1, vector<Point2f> keypoints2)
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// Translation part of a transformation, empty when there is no transformation
+//////////////////////////////////////////////////////////////////////////////
+
+Mat translationPart(Mat transformation)
+{
+	if (transformation.empty())
+		return Mat();
+	return (Mat_<float> (1,2) << transformation.at<double>(0,2), transformation.at<double>(1,2));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Write the translation of the frame as a 2x1 column, its validity is given apart since the
+// translation can be negative. An empty or NaN translation is written as missing
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+void writeGroundTruth(MarkerTrackWriter &track, Mat translation)
+{
+	bool valid = !translation.empty() && translation.at<float>(0) == translation.at<float>(0) && translation.at<float>(1) == translation.at<float>(1);
+	Mat found = (Mat_<uchar> (1,1) << (valid ? 1 : 0));
+	track.write(valid ? translation.reshape(1,2) : Mat(), Mat(), found);
+}
+
+
 ////////////////////
 // Main function
 ///////////////////
@@ -137,17 +169,33 @@ int main(int argc, char **argv)
     
 	
     // Open the datafiles
-	FileStorage markersCenter("_markers_centers.yml", FileStorage::READ);
-	if(! markersCenter.isOpened())
+	MarkerTrackMapping markersTrack;
+	FileStorage markersCenter;
+	if (!markersTrack.open("_markers_centers.mkt"))
 	{
-		cerr <<"Error opening data file !" <<endl;
+		markersCenter.open("_markers_centers.yml", FileStorage::READ);
+		if(! markersCenter.isOpened())
+		{
+			cerr <<"Error opening data file !" <<endl;
+			return -1;
+		}
+	}
+	
+	// One track per ground truth, each one holds a single "marker"
+	Mat trackIds = (Mat_<int> (1,1) << 0);
+	MarkerTrackWriter translation, affine, projective, foreground;
+	if (!translation.open("camera_translation_data.mkt", trackIds, false) || !affine.open("camera_affine_data.mkt", trackIds, false)
+		|| !projective.open("camera_projective_data.mkt", trackIds, false) || !foreground.open("foreground_translation_data.mkt", trackIds, false))
+	{
+		cerr <<"Error creating the ground truth tracks !" <<endl;
 		return -1;
 	}
 	
-	FileStorage translation("camera_translation_data.yml", FileStorage::WRITE);
-	FileStorage affine("camera_affine_data.yml", FileStorage::WRITE);
-	FileStorage projective("camera_projective_data.yml", FileStorage::WRITE);
-	FileStorage foreground("foreground_translation_data.yml", FileStorage::WRITE);
+	// There is no ground truth for the first frame
+	writeGroundTruth(translation, Mat());
+	writeGroundTruth(affine, Mat());
+	writeGroundTruth(projective, Mat());
+	writeGroundTruth(foreground, Mat());
 	
 	// Variables initialization
 	vector<KeyPoint> keypoints;
@@ -163,29 +211,46 @@ int main(int argc, char **argv)
 	// Do the first frame out of the main loop
 	capture >> frame;
 	
-	markersCenter["ids"] >> ids;
+	if (markersTrack.isOpened())
+		ids = markersTrack.getIds();
+	else
+		markersCenter["ids"] >> ids;
 	
 	stringstream frameNumber;
-	int frameCount = (int)  markersCenter["frameCount"];
+	int frameCount = markersTrack.isOpened() ? markersTrack.getFrameCount() : (int)  markersCenter["frameCount"];
 	
+	int frameStage = Profiler::stage("frame");
+	int groundTruthStage = Profiler::stage("ground truth");
 	for(int Noframe = 2; Noframe <= frameCount; Noframe++ )
 	{
+		ScopedZone frameZone(frameStage);
 		Mat centersMatrix, centersMatrix_1;
 		// Acquire new frame
-		capture >> frame;
+		{
+			ScopedZone zone(STAGE_CAPTURE);
+			capture >> frame;
+		}
 		
 		// End when video finishes
 		if (frame.empty() )
 			break;
 		
 		// Retrive information about the center and the corners of the markers
-		frameNumber.str("");
-		frameNumber << "frame" << Noframe-1;
-		markersCenter [frameNumber.str()] >> centersMatrix_1;
-		
-		frameNumber.str("");
-		frameNumber << "frame" << Noframe;
-		markersCenter [frameNumber.str()] >> centersMatrix;
+		if (markersTrack.isOpened())
+		{
+			centersMatrix_1 = markersTrack.getCenters(Noframe-1);
+			centersMatrix = markersTrack.getCenters(Noframe);
+		}
+		else
+		{
+			frameNumber.str("");
+			frameNumber << "frame" << Noframe-1;
+			markersCenter [frameNumber.str()] >> centersMatrix_1;
+			
+			frameNumber.str("");
+			frameNumber << "frame" << Noframe;
+			markersCenter [frameNumber.str()] >> centersMatrix;
+		}
 		kpt2.clear();
 		kpt1.clear();
 		
@@ -210,36 +275,37 @@ int main(int argc, char **argv)
 // 		imshow("opticalflow Image", frame);
 // 		char c = waitKey(1000/fps);
 		
+		// The ground truth of the background and of the foreground is timed until the end of the frame
+		ScopedZone groundTruthZone(groundTruthStage);
+		
 		if (kpt2.size() < 3)
 		{
-			foundHomography.release();
-			projective << frameNumber.str() << foundHomography;
-			affine << frameNumber.str() << foundHomography;
+			writeGroundTruth(projective, Mat());
+			writeGroundTruth(affine, Mat());
 			
 			foundHomography = findTranslation(kpt1,kpt2);
-			translation << frameNumber.str() << foundHomography;
+			writeGroundTruth(translation, foundHomography);
 		}
 		
 		else if (kpt2.size() == 3)
 		{
-			foundHomography.release();
-			projective << frameNumber.str() << foundHomography;
+			writeGroundTruth(projective, Mat());
 			
 			foundHomography = getAffineTransform(kpt1,kpt2);
-			affine << frameNumber.str() << (Mat_<float> (1,2) << foundHomography.at<double>(0,2), foundHomography.at<double>(1,2));
+			writeGroundTruth(affine, translationPart(foundHomography));
 			
 			foundHomography = findTranslation(kpt1,kpt2);
-			translation << frameNumber.str() << foundHomography;
+			writeGroundTruth(translation, foundHomography);
 			
 		}
 		
 		else if (kpt2.size() > 3)
 		{
 			foundHomography = findHomography(kpt1,kpt2,CV_RANSAC,3);
-			projective << frameNumber.str() << (Mat_<float> (1,2) << foundHomography.at<double>(0,2), foundHomography.at<double>(1,2));
+			writeGroundTruth(projective, translationPart(foundHomography));
 			
 			foundHomography = findTranslation(kpt1,kpt2);
-			translation << frameNumber.str() << foundHomography;
+			writeGroundTruth(translation, foundHomography);
 			
 			kpt2.clear();
 			kpt1.clear();
@@ -254,7 +320,7 @@ int main(int argc, char **argv)
 			}
 			
 			foundHomography = getAffineTransform(kpt1,kpt2);
-			affine << frameNumber.str() <<(Mat_<float> (1,2) << foundHomography.at<double>(0,2), foundHomography.at<double>(1,2));
+			writeGroundTruth(affine, translationPart(foundHomography));
 			
 		}
 		
@@ -273,9 +339,7 @@ int main(int argc, char **argv)
 			}
 		
 		foundHomography = findTranslation(kpt1,kpt2);
-		if (foundHomography.at<float>(0) != foundHomography.at<float>(0))
-			foundHomography.release();
-		foreground << frameNumber.str() << foundHomography;
+		writeGroundTruth(foreground, foundHomography);
 		
 		
 // 		// Program control
@@ -286,19 +350,18 @@ int main(int argc, char **argv)
 // 		option.screenshot(c, frame);
 	}
 	
-	translation << "frameCount" << frameCount;
-	affine << "frameCount" << frameCount;
-	projective << "frameCount" << frameCount;
-	foreground << "frameCount" << frameCount;
-	
-	
-	// close the data files
+	// close the data files, the writers finish their last frames
+	markersTrack.close();
 	markersCenter.release();
-	translation.release();
-	affine.release();
-	projective.release();
-	foreground.release();
+	{
+		ScopedZone zone(STAGE_OUTPUT);
+		translation.close();
+		affine.close();
+		projective.close();
+		foreground.close();
+	}
 	
+	Profiler::summary();
 	
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,469 @@
+// Standard libraries
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+// Header
+#include "MarkerTrack.h"
+
+// Global variables
+const char MARKER_TRACK_MAGIC[8] = {'M','K','T','R','A','C','K','1'};
+size_t const MARKER_TRACK_ALIGNMENT = 64;
+
+
+MarkerTrackLayout::MarkerTrackLayout(int markerCount, bool hasCorners)
+{
+	this->markerCount = markerCount;
+	this->hasCorners = hasCorners;
+
+	centersOffset = 0;
+	cornersOffset = centersOffset + MARKER_TRACK_CENTER_ROWS*markerCount*sizeof(float);
+	missingOffset = cornersOffset + (hasCorners ? MARKER_TRACK_CORNER_ROWS*markerCount*sizeof(float) : 0);
+
+	// The next record stays aligned on the floats
+	recordSize = missingOffset + (markerCount+7)/8;
+	recordSize = (recordSize + sizeof(float)-1)/sizeof(float)*sizeof(float);
+}
+
+
+bool MarkerTrackLayout::isMissing(const char *record, int marker) const
+{
+	return (record[missingOffset + marker/8] >> (marker%8)) & 1;
+}
+
+
+// Check the header at the start of data and read the ids
+bool readMarkerTrackHeader(const char *data, size_t size, MarkerTrackHeader &header, cv::Mat &ids)
+{
+	if (size < sizeof(MarkerTrackHeader))
+		return false;
+	memcpy(&header, data, sizeof(MarkerTrackHeader));
+
+	if (memcmp(header.magic, MARKER_TRACK_MAGIC, sizeof(header.magic)) != 0 || header.version != MARKER_TRACK_VERSION)
+		return false;
+	if (header.dataOffset < sizeof(MarkerTrackHeader) + header.markerCount*sizeof(int32_t) || header.dataOffset > size)
+		return false;
+	if (header.recordSize == 0 || header.recordSize != MarkerTrackLayout(header.markerCount, header.hasCorners).recordSize)
+		return false;
+
+	// The frame count of an unfinished file is the one of the last checkpoint,
+	// every complete record that follows the header is taken instead
+	if (!header.finished)
+		header.frameCount = (size - header.dataOffset)/header.recordSize;
+
+	ids.create(1, header.markerCount, CV_32S);
+	memcpy(ids.data, data + sizeof(MarkerTrackHeader), header.markerCount*sizeof(int32_t));
+	return true;
+}
+
+
+// Writer
+MarkerTrackWriter::MarkerTrackWriter()
+{
+	memset(&header, 0, sizeof(header));
+	checkpointFrames = 0;
+	queuedFrames = 0;
+	stopping = false;
+}
+
+MarkerTrackWriter::~MarkerTrackWriter()
+{
+	close();
+}
+
+
+// Write the header and the ids then start the writer thread
+// A track has at least one marker, the record of a frame is never empty
+bool MarkerTrackWriter::open(std::string filename, cv::Mat ids, bool hasCorners, int checkpointFrames)
+{
+	close();
+	if (ids.cols <= 0)
+		return false;
+
+	file.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	layout = MarkerTrackLayout(ids.cols, hasCorners);
+	record.assign(layout.recordSize, 0);
+	this->checkpointFrames = std::max(checkpointFrames, 1);
+	queuedFrames = 0;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MARKER_TRACK_MAGIC, sizeof(header.magic));
+	header.version = MARKER_TRACK_VERSION;
+	header.markerCount = ids.cols;
+	header.hasCorners = hasCorners;
+	header.recordSize = layout.recordSize;
+	header.frameCount = 0;
+	header.dataOffset = (sizeof(MarkerTrackHeader) + ids.cols*sizeof(int32_t) + MARKER_TRACK_ALIGNMENT-1)/MARKER_TRACK_ALIGNMENT*MARKER_TRACK_ALIGNMENT;
+	header.finished = 0;
+
+	cv::Mat ids32;
+	ids.convertTo(ids32, CV_32S);
+	std::vector<char> start(header.dataOffset, 0);
+	memcpy(&start[0], &header, sizeof(header));
+	memcpy(&start[sizeof(header)], ids32.data, ids.cols*sizeof(int32_t));
+	file.write(&start[0], start.size());
+	file.flush();
+	if (!file.good())
+	{
+		file.close();
+		return false;
+	}
+
+	stopping = false;
+	writer = std::thread(&MarkerTrackWriter::writerLoop, this);
+	return true;
+}
+
+
+bool MarkerTrackWriter::isOpened()
+{
+	return file.is_open();
+}
+
+
+// Pack the markers of the next frame and queue them, the matrices are the ones of MarkersDetector.
+// found (CV_8U, 1 x markers, 0 when the marker is missing) gives the missing flags of data whose coordinates
+// can be negative, like the ground truth translations. Without it a negative center is a missing marker.
+void MarkerTrackWriter::write(cv::Mat centersMatrix, cv::Mat cornersMatrix, cv::Mat found)
+{
+	if (!isOpened())
+		return;
+
+	float *centers = (float*) &record[layout.centersOffset];
+	float *corners = (float*) &record[layout.cornersOffset];
+	char *missing = &record[layout.missingOffset];
+	memset(missing, 0, record.size() - layout.missingOffset);
+
+	for(int i=0; i<layout.markerCount; ++i)
+	{
+		for(int r=0; r<MARKER_TRACK_CENTER_ROWS; ++r)
+			centers[r*layout.markerCount + i] = (i < centersMatrix.cols && r < centersMatrix.rows) ? centersMatrix.at<float>(r,i) : -1.f;
+
+		if (layout.hasCorners)
+			for(int r=0; r<MARKER_TRACK_CORNER_ROWS; ++r)
+				corners[r*layout.markerCount + i] = (i < cornersMatrix.cols && r < cornersMatrix.rows) ? cornersMatrix.at<float>(r,i) : -1.f;
+
+		bool isMissing;
+		if (!found.empty())
+			isMissing = (i >= (int) found.total()) || found.at<uchar>(i) == 0;
+		else
+			isMissing = centers[i] < 0 || centers[layout.markerCount + i] < 0;
+		if (isMissing)
+			missing[i/8] |= 1 << (i%8);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending.insert(pending.end(), record.begin(), record.end());
+	}
+	wakeUp.notify_one();
+	queuedFrames++;
+}
+
+
+// Frames given to write(), some of them may still be waiting for the writer thread
+int MarkerTrackWriter::getFrameCount()
+{
+	return queuedFrames;
+}
+
+
+// Rewrite the header then go back to the end of the records
+void MarkerTrackWriter::writeHeader(uint64_t frameCount, bool finished)
+{
+	header.frameCount = frameCount;
+	header.finished = finished;
+	std::streampos end = file.tellp();
+	file.seekp(0);
+	file.write((const char*) &header, sizeof(header));
+	file.seekp(end);
+	file.flush();
+}
+
+
+// Writer thread : writes the queued records by batches and makes a checkpoint every checkpointFrames frames
+void MarkerTrackWriter::writerLoop()
+{
+	std::vector<char> writing;
+	uint64_t written = 0, checkpoint = 0;
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (true)
+	{
+		wakeUp.wait(guard, [this]{ return stopping || !pending.empty(); });
+		if (pending.empty())
+			break;
+		writing.swap(pending);
+		guard.unlock();
+
+		// Each batch goes to the system at once, a crash only loses the frames still in the queue
+		file.write(&writing[0], writing.size());
+		file.flush();
+		written += writing.size()/layout.recordSize;
+		writing.clear();
+		if (written - checkpoint >= (uint64_t) checkpointFrames)
+		{
+			writeHeader(written, false);
+			checkpoint = written;
+		}
+
+		guard.lock();
+	}
+	guard.unlock();
+
+	writeHeader(written, true);
+}
+
+
+// Wait for the queued frames, mark the file as finished and close it
+void MarkerTrackWriter::close()
+{
+	if (!file.is_open())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wakeUp.notify_one();
+	writer.join();
+	file.close();
+}
+
+
+// Reader
+MarkerTrackReader::MarkerTrackReader()
+{
+	memset(&header, 0, sizeof(header));
+}
+
+
+bool MarkerTrackReader::open(std::string filename)
+{
+	data.clear();
+	std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	file.seekg(0);
+	data.resize(size);
+	if (size == 0 || !file.read(&data[0], size))
+	{
+		data.clear();
+		return false;
+	}
+
+	if (!readMarkerTrackHeader(&data[0], data.size(), header, ids)
+		|| header.dataOffset + header.frameCount*header.recordSize > data.size())
+	{
+		std::cerr << "\n" << filename << " is not a valid marker track file ! \n" << std::endl;
+		data.clear();
+		return false;
+	}
+	if (!header.finished)
+		std::cerr << filename << " was not closed, " << header.frameCount << " frames recovered" << std::endl;
+
+	layout = MarkerTrackLayout(header.markerCount, header.hasCorners);
+	return true;
+}
+
+
+bool MarkerTrackReader::isOpened()
+{
+	return !data.empty();
+}
+
+int MarkerTrackReader::getFrameCount()
+{
+	return isOpened() ? (int) header.frameCount : 0;
+}
+
+int MarkerTrackReader::getMarkerCount()
+{
+	return (int) header.markerCount;
+}
+
+bool MarkerTrackReader::hasCorners()
+{
+	return header.hasCorners;
+}
+
+cv::Mat MarkerTrackReader::getIds()
+{
+	return ids;
+}
+
+
+// 2 x markerCount centers of the frame, empty when the frame is not in the file
+cv::Mat MarkerTrackReader::getCenters(int frame)
+{
+	if (frame < 1 || frame > getFrameCount())
+		return cv::Mat();
+	char *record = &data[header.dataOffset + (size_t) (frame-1)*header.recordSize];
+	return cv::Mat(MARKER_TRACK_CENTER_ROWS, layout.markerCount, CV_32F, record + layout.centersOffset);
+}
+
+
+// 8 x markerCount corners of the frame, empty when the frame or the corners are not in the file
+cv::Mat MarkerTrackReader::getCorners(int frame)
+{
+	if (frame < 1 || frame > getFrameCount() || !layout.hasCorners)
+		return cv::Mat();
+	char *record = &data[header.dataOffset + (size_t) (frame-1)*header.recordSize];
+	return cv::Mat(MARKER_TRACK_CORNER_ROWS, layout.markerCount, CV_32F, record + layout.cornersOffset);
+}
+
+
+bool MarkerTrackReader::isMissing(int frame, int marker)
+{
+	if (frame < 1 || frame > getFrameCount() || marker < 0 || marker >= layout.markerCount)
+		return true;
+	return layout.isMissing(&data[header.dataOffset + (size_t) (frame-1)*header.recordSize], marker);
+}
+
+
+// Mapping
+MarkerTrackMapping::MarkerTrackMapping()
+{
+	fd = -1;
+	data = NULL;
+	size = 0;
+	memset(&header, 0, sizeof(header));
+}
+
+MarkerTrackMapping::~MarkerTrackMapping()
+{
+	close();
+}
+
+
+bool MarkerTrackMapping::open(std::string filename)
+{
+	close();
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size == 0)
+	{
+		close();
+		return false;
+	}
+	size = status.st_size;
+
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (mapping == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	data = (const char*) mapping;
+
+	if (!readMarkerTrackHeader(data, size, header, ids)
+		|| header.dataOffset + header.frameCount*header.recordSize > size)
+	{
+		std::cerr << "\n" << filename << " is not a valid marker track file ! \n" << std::endl;
+		close();
+		return false;
+	}
+	if (!header.finished)
+		std::cerr << filename << " was not closed, " << header.frameCount << " frames recovered" << std::endl;
+
+	layout = MarkerTrackLayout(header.markerCount, header.hasCorners);
+	return true;
+}
+
+
+void MarkerTrackMapping::close()
+{
+	if (data != NULL)
+		munmap((void*) data, size);
+	if (fd >= 0)
+		::close(fd);
+
+	fd = -1;
+	data = NULL;
+	size = 0;
+	memset(&header, 0, sizeof(header));
+}
+
+
+bool MarkerTrackMapping::isOpened()
+{
+	return data != NULL;
+}
+
+int MarkerTrackMapping::getFrameCount()
+{
+	return (int) header.frameCount;
+}
+
+int MarkerTrackMapping::getMarkerCount()
+{
+	return (int) header.markerCount;
+}
+
+bool MarkerTrackMapping::hasCorners()
+{
+	return header.hasCorners;
+}
+
+cv::Mat MarkerTrackMapping::getIds()
+{
+	return ids;
+}
+
+
+// Start of the record of the frame, NULL when the frame is not in the file
+const char *MarkerTrackMapping::record(int frame)
+{
+	if (frame < 1 || frame > getFrameCount())
+		return NULL;
+	return data + header.dataOffset + (size_t) (frame-1)*header.recordSize;
+}
+
+
+cv::Mat MarkerTrackMapping::getCenters(int frame)
+{
+	const char *start = record(frame);
+	if (start == NULL)
+		return cv::Mat();
+	return cv::Mat(MARKER_TRACK_CENTER_ROWS, layout.markerCount, CV_32F, (void*) (start + layout.centersOffset));
+}
+
+
+cv::Mat MarkerTrackMapping::getCorners(int frame)
+{
+	const char *start = record(frame);
+	if (start == NULL || !layout.hasCorners)
+		return cv::Mat();
+	return cv::Mat(MARKER_TRACK_CORNER_ROWS, layout.markerCount, CV_32F, (void*) (start + layout.cornersOffset));
+}
+
+
+bool MarkerTrackMapping::isMissing(int frame, int marker)
+{
+	const char *start = record(frame);
+	if (start == NULL || marker < 0 || marker >= layout.markerCount)
+		return true;
+	return layout.isMissing(start, marker);
+}
@@ -2,14 +2,16 @@
  * Author:	Hélène Loozen 
  * Date:	2016
  * 
- * << MarkersDetector >> finds the ArUco markers in each frame of a video and write their position in a YAML file
+ * << MarkersDetector >> finds the ArUco markers in each frame of a video and write their position in a marker track
+ * (markers.mkt, see MarkerTrack.h), appended frame by frame on a background thread so that
+ * the file stays readable if the program is stopped before the end of the video
  * 
  * This program works alongside two others : << CameraMotion.cpp >> and << MarkerDataFilter.cpp >>
  * 
  * How to use :
  * 1. Choose a video containing ArUco markers
  * 2. Use << MarkersDetector >> on the chosen video
- * 3. Use << MarkerDataFilter >> on the output YAML files of << MarkersDetector >> 
+ * 3. Use << MarkerDataFilter >> on the output track of << MarkersDetector >> 
  * 4. Use << CameraMotion >> with the output YAML files of << MarkerDataFilter >>
  * 
  */
@@ -30,6 +32,8 @@
 
 // Others
 #include "OutputControl.h"
+#include "Profiler.h"
+#include "MarkerTrack.h"
 
 // Namespaces
 using namespace cv;
@@ -70,17 +74,16 @@ int main(int argc, char **argv)
 	if (fps!=fps)
 		fps=DEFAULT_FPS;
 
-	int frameCount = 0;
-	stringstream frameNumber;
 	OutputControl option;
 	
-	FileStorage markers_centers("markers_centers.yml", FileStorage::WRITE);
-	FileStorage markers_corners("markers_corners.yml", FileStorage::WRITE);
-	
-	// The first line of the file contains the markers ids
+	// The header of the track contains the markers ids
 	Mat ids = (Mat_<int> (1,10) <<10,20,30,40,50,60,70,80,90,100);
-	markers_centers << "ids" << ids;
-	markers_corners << "ids" << ids;
+	MarkerTrackWriter markers;
+	if (!markers.open("markers.mkt", ids, true))
+	{
+		cerr << "Failed to create the marker track" << endl;
+		return -1;
+	}
 	
 	// Markerdetector initialization
 	MarkerDetector MDetector;
@@ -88,64 +91,75 @@ int main(int argc, char **argv)
 	vector<Marker> Markers;
 	
 	Mat frame;
+	Mat centersMatrix(2,10,CV_32F), cornersMatrix(8,10,CV_32F);
+	int frameStage = Profiler::stage("frame");
 	while(true)
 	{
+		ScopedZone frameZone(frameStage);
+		
 		// Acquire new frame
-		capture >> frame;
+		{
+			ScopedZone zone(STAGE_CAPTURE);
+			capture >> frame;
+		}
 		
 		// End when video finishes
 		if (frame.empty())
 			break;
 		
 		// Detect markers
-		MDetector.detect(frame,Markers);
-		sort(Markers.begin(),Markers.end(),sort_markers);
-		
-		Mat centersMatrix(2,10,CV_32F, Scalar::all(-1.));
-		Mat cornersMatrix(8,10,CV_32F, Scalar::all(-1.));
-		
-		// Put the centers in a matrix
-		int k =0;
-		for(int j=0; j<centersMatrix.cols; ++j)
-			if(k<Markers.size() && Markers[k].id==(j+1)*10)
-			{
-				centersMatrix.at<float>(0,j)=Markers[k].getCenter().x;
-				centersMatrix.at<float>(1,j)=Markers[k].getCenter().y;
-				k++;
-			}
-			
-		// Put the corners in a matrix	
-		for(int i=0;i<cornersMatrix.rows/2;i++)
 		{
-			int k=0;
-			for(int j=0; j<cornersMatrix.cols; ++j)
-			if(k<Markers.size() && Markers[k].id==(j+1)*10)
+			ScopedZone zone(STAGE_DETECT);
+			MDetector.detect(frame,Markers);
+			sort(Markers.begin(),Markers.end(),sort_markers);
+			
+			centersMatrix.setTo(Scalar::all(-1.));
+			cornersMatrix.setTo(Scalar::all(-1.));
+			
+			// Put the centers in a matrix
+			int k =0;
+			for(int j=0; j<centersMatrix.cols; ++j)
+				if(k<Markers.size() && Markers[k].id==(j+1)*10)
+				{
+					centersMatrix.at<float>(0,j)=Markers[k].getCenter().x;
+					centersMatrix.at<float>(1,j)=Markers[k].getCenter().y;
+					k++;
+				}
+				
+			// Put the corners in a matrix	
+			for(int i=0;i<cornersMatrix.rows/2;i++)
 			{
-				cornersMatrix.at<float>(0+(2*i),j)=Markers[k].at(i).x;
-				cornersMatrix.at<float>(1+(2*i),j)=Markers[k].at(i).y;
-				k++;
+				int k=0;
+				for(int j=0; j<cornersMatrix.cols; ++j)
+				if(k<Markers.size() && Markers[k].id==(j+1)*10)
+				{
+					cornersMatrix.at<float>(0+(2*i),j)=Markers[k].at(i).x;
+					cornersMatrix.at<float>(1+(2*i),j)=Markers[k].at(i).y;
+					k++;
+				}
 			}
 		}
-
-		// Draw markers
-		for(int i =0;i<Markers.size();i++)
-			Markers[i].draw(frame,Scalar(0,0,225),8);
-		
-		// Write the center and the corners information in the file
-		frameNumber << "frame" << ++frameCount;
-		markers_centers << frameNumber.str() << centersMatrix;
-		markers_corners << frameNumber.str() << cornersMatrix;
-		frameNumber.str("");
 		
-		//Show treshholded image
-		namedWindow("Thresholded Image",0);
-		resizeWindow("Thresholded Image", 600,380);
-		imshow("Thresholded Image",MDetector.getThresholdedImage());
-		
-		// Show video with markers
-		namedWindow("Marked Image",0);
-		resizeWindow("Marked Image", 600,380);
-		imshow("Marked Image",frame);
+		{
+			ScopedZone zone(STAGE_OUTPUT);
+			
+			// Draw markers
+			for(int i =0;i<Markers.size();i++)
+				Markers[i].draw(frame,Scalar(0,0,225),8);
+			
+			// Queue the center and the corners information for the writer thread
+			markers.write(centersMatrix, cornersMatrix);
+			
+			//Show treshholded image
+			namedWindow("Thresholded Image",0);
+			resizeWindow("Thresholded Image", 600,380);
+			imshow("Thresholded Image",MDetector.getThresholdedImage());
+			
+			// Show video with markers
+			namedWindow("Marked Image",0);
+			resizeWindow("Marked Image", 600,380);
+			imshow("Marked Image",frame);
+		}
 		
 		// Program control
 		char c = waitKey(1000/fps);
@@ -155,12 +169,13 @@ int main(int argc, char **argv)
 			break;
 	}
 	
-	// Add the framecount to be able to loop in other programs
-	markers_centers << "frameCount" << frameCount;
-	markers_corners << "frameCount" << frameCount;
+	// Write the last frames and the final framecount
+	{
+		ScopedZone zone(STAGE_OUTPUT);
+		markers.close();
+	}
 	
-	markers_centers.release();
-	markers_corners.release();
+	Profiler::summary();
 	
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,292 @@
+#pragma once
+
+// Standard libraries
+#include <cmath>
+#include <algorithm>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+
+// Kalman filter of fixed size, every matrix is an array of the object so nothing is allocated.
+// It follows cv::KalmanFilter : predict() copies the prediction in the corrected state and its
+// covariance like OpenCV 2.4, correct() uses the prediction.
+// The measures are the first MeasDim values of the state, the measurement matrix is [I 0] so
+// it is never multiplied, S is the top left block of the covariance and P'H^T its first columns.
+template<int StateDim, int MeasDim>
+class Kalman
+{
+public:
+	static_assert(MeasDim <= StateDim, "The measures are the first values of the state");
+	static constexpr int stateDim = StateDim;
+	static constexpr int measDim = MeasDim;
+
+	float statePre[StateDim];
+	float statePost[StateDim];
+	float transitionMatrix[StateDim][StateDim];
+	float processNoiseCov[StateDim][StateDim];
+	float measurementNoiseCov[MeasDim][MeasDim];
+	float errorCovPre[StateDim][StateDim];
+	float errorCovPost[StateDim][StateDim];
+
+	Kalman()
+	{
+		init();
+	}
+
+	// Null state, identity transition, and the noises of the filters of the repository on the diagonals
+	void init(float processNoise = 1e-4f, float measurementNoise = 1e-1f, float errorCov = .1f)
+	{
+		for(int i=0; i<StateDim; ++i)
+		{
+			statePre[i] = statePost[i] = 0;
+			for(int j=0; j<StateDim; ++j)
+			{
+				transitionMatrix[i][j] = (i == j);
+				processNoiseCov[i][j] = (i == j) ? processNoise : 0;
+				errorCovPre[i][j] = 0;
+				errorCovPost[i][j] = (i == j) ? errorCov : 0;
+			}
+		}
+		for(int i=0; i<MeasDim; ++i)
+			for(int j=0; j<MeasDim; ++j)
+				measurementNoiseCov[i][j] = (i == j) ? measurementNoise : 0;
+	}
+
+	// x' = F x and P' = F P F^T + Q
+	const float *predict()
+	{
+		float temp[StateDim][StateDim];
+		for(int i=0; i<StateDim; ++i)
+		{
+			float sum = 0;
+			for(int k=0; k<StateDim; ++k)
+				sum += transitionMatrix[i][k]*statePost[k];
+			statePre[i] = sum;
+
+			for(int j=0; j<StateDim; ++j)
+			{
+				sum = 0;
+				for(int k=0; k<StateDim; ++k)
+					sum += transitionMatrix[i][k]*errorCovPost[k][j];
+				temp[i][j] = sum;
+			}
+		}
+
+		for(int i=0; i<StateDim; ++i)
+			for(int j=0; j<StateDim; ++j)
+			{
+				float sum = processNoiseCov[i][j];
+				for(int k=0; k<StateDim; ++k)
+					sum += temp[i][k]*transitionMatrix[j][k];
+				errorCovPre[i][j] = sum;
+			}
+
+		// Same as OpenCV for the frames without measure
+		for(int i=0; i<StateDim; ++i)
+		{
+			statePost[i] = statePre[i];
+			for(int j=0; j<StateDim; ++j)
+				errorCovPost[i][j] = errorCovPre[i][j];
+		}
+		return statePre;
+	}
+
+	// K = P'H^T (HP'H^T + R)^-1, x = x' + K (z - Hx') and P = P' - K H P'
+	const float *correct(const float *measurement)
+	{
+		float S[MeasDim][MeasDim], inverse[MeasDim][MeasDim];
+		for(int i=0; i<MeasDim; ++i)
+			for(int j=0; j<MeasDim; ++j)
+				S[i][j] = errorCovPre[i][j] + measurementNoiseCov[i][j];
+		if (!invert(S, inverse))
+			return statePost;
+
+		float gain[StateDim][MeasDim];
+		for(int i=0; i<StateDim; ++i)
+			for(int j=0; j<MeasDim; ++j)
+			{
+				float sum = 0;
+				for(int k=0; k<MeasDim; ++k)
+					sum += errorCovPre[i][k]*inverse[k][j];
+				gain[i][j] = sum;
+			}
+
+		float innovation[MeasDim];
+		for(int k=0; k<MeasDim; ++k)
+			innovation[k] = measurement[k] - statePre[k];
+
+		for(int i=0; i<StateDim; ++i)
+		{
+			float sum = statePre[i];
+			for(int k=0; k<MeasDim; ++k)
+				sum += gain[i][k]*innovation[k];
+			statePost[i] = sum;
+
+			for(int j=0; j<StateDim; ++j)
+			{
+				sum = errorCovPre[i][j];
+				for(int k=0; k<MeasDim; ++k)
+					sum -= gain[i][k]*errorCovPre[k][j];
+				errorCovPost[i][j] = sum;
+			}
+		}
+		return statePost;
+	}
+
+private:
+	// Gauss-Jordan with partial pivoting, false when the matrix is singular
+	static bool invert(float (&a)[MeasDim][MeasDim], float (&inverse)[MeasDim][MeasDim])
+	{
+		for(int i=0; i<MeasDim; ++i)
+			for(int j=0; j<MeasDim; ++j)
+				inverse[i][j] = (i == j);
+
+		for(int c=0; c<MeasDim; ++c)
+		{
+			int pivot = c;
+			for(int r=c+1; r<MeasDim; ++r)
+				if (std::abs(a[r][c]) > std::abs(a[pivot][c]))
+					pivot = r;
+			if (a[pivot][c] == 0)
+				return false;
+
+			for(int j=0; j<MeasDim; ++j)
+			{
+				std::swap(a[c][j], a[pivot][j]);
+				std::swap(inverse[c][j], inverse[pivot][j]);
+			}
+
+			float scale = 1.f/a[c][c];
+			for(int j=0; j<MeasDim; ++j)
+			{
+				a[c][j] *= scale;
+				inverse[c][j] *= scale;
+			}
+
+			for(int r=0; r<MeasDim; ++r)
+				if (r != c && a[r][c] != 0)
+				{
+					float factor = a[r][c];
+					for(int j=0; j<MeasDim; ++j)
+					{
+						a[r][j] -= factor*a[c][j];
+						inverse[r][j] -= factor*inverse[c][j];
+					}
+				}
+		}
+		return true;
+	}
+};
+
+
+// Motion models of the position filters : their transition is the identity plus the terms
+// written by setTransition(), the same matrices as the former transitionMatrixUpdate()
+struct ConstantVelocity
+{
+	// (x, y, vx, vy)
+	static constexpr int stateDim = 4;
+
+	static void setTransition(float (&F)[stateDim][stateDim], float dt, float dv)
+	{
+		F[0][2] = dt;
+		F[1][3] = dt;
+	}
+};
+
+struct ConstantAcceleration
+{
+	// (x, y, vx, vy, ax, ay)
+	static constexpr int stateDim = 6;
+
+	static void setTransition(float (&F)[stateDim][stateDim], float dt, float dv)
+	{
+		F[0][2] = dt;
+		F[1][3] = dt;
+		F[0][4] = 0.5f*dv;
+		F[1][5] = 0.5f*dv;
+		F[2][4] = dv;
+		F[3][5] = dv;
+	}
+};
+
+
+// Filter of a 2D position, constant velocity or constant acceleration when dv >= 0 like the
+// former initKalman(). The transition is only written again when dt or dv change.
+class PositionKalman
+{
+private:
+	Kalman<ConstantVelocity::stateDim, 2> velocityFilter;
+	Kalman<ConstantAcceleration::stateDim, 2> accelerationFilter;
+	bool acceleration;
+	float dt;
+	float dv;
+
+public:
+	PositionKalman(float x = 0, float y = 0, float dt = 1, float dv = -1)
+	{
+		init(x, y, dt, dv);
+	}
+
+	void init(float x, float y, float dt = 1, float dv = -1)
+	{
+		acceleration = (dv >= 0);
+		this->dt = dt;
+		this->dv = dv;
+		if (acceleration)
+		{
+			accelerationFilter.init();
+			ConstantAcceleration::setTransition(accelerationFilter.transitionMatrix, dt, dv);
+			accelerationFilter.statePre[0] = accelerationFilter.statePost[0] = x;
+			accelerationFilter.statePre[1] = accelerationFilter.statePost[1] = y;
+		}
+		else
+		{
+			velocityFilter.init();
+			ConstantVelocity::setTransition(velocityFilter.transitionMatrix, dt, dv);
+			velocityFilter.statePre[0] = velocityFilter.statePost[0] = x;
+			velocityFilter.statePre[1] = velocityFilter.statePost[1] = y;
+		}
+	}
+
+	// The model stays the one chosen by init(), only its terms change
+	void setTransition(float dt, float dv)
+	{
+		if (dt == this->dt && dv == this->dv)
+			return;
+		this->dt = dt;
+		this->dv = dv;
+		if (acceleration)
+			ConstantAcceleration::setTransition(accelerationFilter.transitionMatrix, dt, dv);
+		else
+			ConstantVelocity::setTransition(velocityFilter.transitionMatrix, dt, dv);
+	}
+
+	cv::Point2f predict()
+	{
+		const float *state = acceleration ? accelerationFilter.predict() : velocityFilter.predict();
+		return cv::Point2f(state[0], state[1]);
+	}
+
+	cv::Point2f correct(float x, float y)
+	{
+		float measurement[2] = {x, y};
+		const float *state = acceleration ? accelerationFilter.correct(measurement) : velocityFilter.correct(measurement);
+		return cv::Point2f(state[0], state[1]);
+	}
+
+	// Corrected position
+	cv::Point2f position() const
+	{
+		const float *state = acceleration ? accelerationFilter.statePost : velocityFilter.statePost;
+		return cv::Point2f(state[0], state[1]);
+	}
+
+	void setPosition(float x, float y)
+	{
+		float *state = acceleration ? accelerationFilter.statePost : velocityFilter.statePost;
+		state[0] = x;
+		state[1] = y;
+	}
+};
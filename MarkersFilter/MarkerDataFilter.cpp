@@ -3,14 +3,22 @@
  * Date:	2016
  * 
  * << MarkerDataFilter >> fill the missing ArUco marker position thanks to a simple Kalman filter (position -- speed [-- acceleration])
+ * of fixed size (Kalman.h)
  * 
  * This program works alongside two others : << CameraMotion.cpp >> and << MarkersDetector.cpp >>
  * 
  * How to use :
  * 1. Choose a video containing ArUco markers
  * 2. Use << MarkersDetector >> on the chosen video
- * 3. Use << MarkerDataFilter >> on the output YAML files of << MarkersDetector >> 
- * 4. Use << CameraMotion >> with the output YAML files of << MarkerDataFilter >>
+ * 3. Use << MarkerDataFilter >> on the output track of << MarkersDetector >> 
+ * 4. Use << CameraMotion >> with the output track of << MarkerDataFilter >>
+ * 
+ * The input is markers.mkt, or the former YAML files markers_centers.yml and markers_corners.yml,
+ * the output filtered_markers.mkt is written frame by frame on a background thread
+ * 
+ * The filters of the markers are independent : the whole track is loaded, then each marker is
+ * filtered over all the frames by a pool of threads (one marker per task) before writing the result.
+ * << MarkerDataFilter [threads] >>, the default is the number of cores
  * 
  */
 
@@ -18,11 +26,20 @@
 // Standard libraries
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <atomic>
 
 // OpenCV libraries
 #include <opencv2/opencv.hpp>
 #include "opencv2/features2d/features2d.hpp"
 
+// Others
+#include "MarkerTrack.h"
+#include "Kalman.h"
+#include "Profiler.h"
+
 // Namespaces
 using namespace cv;
 using namespace std;
@@ -31,126 +48,125 @@ using namespace std;
 int const MAX_MISSING_DATA = 20;
 
 //////////////////////////////////////////
-// Initialization of the Kalman filter	
+// Kalman prediction and model update	
 /////////////////////////////////////////
 
-void initKalman (KalmanFilter *KF, float x , float y, float dt ,float dv=-1.);
-void initKalman (KalmanFilter *KF, float x , float y, float dt,float dv)
+Point2f KalmanModelUpdate (PositionKalman &KF, float x , float y, int &missingData)
 {
-	if ( dv<0 )
-	{
-		// KalmanFilter 2D traker with position and constant velocity
-		KF->init(4,2,0);
-		KF->transitionMatrix = *(Mat_<float>(4, 4) << 
-		1, 0, dt, 0,
-		0, 1, 0, dt,
-		0, 0, 1, 0,
-		0, 0, 0, 1);
-	}
+	Point2f prediction = KF.predict();
 	
-	else
+	if(missingData < MAX_MISSING_DATA && (x<0 || y<0))
 	{
-		// KalmanFilter 2D traker with position, velocity and constant acceleration
-		KF->init(6,2,0);
-		KF->transitionMatrix = *(Mat_<float>(6, 6) <<
-		1, 0, dt, 0, 0.5*dv, 0,
-		0, 1, 0, dt, 0, 0.5*dv, 
-		0, 0, 1, 0, dv, 0, 
-		0, 0, 0, 1, 0, dv,
-		0, 0, 0, 0, 1, 0,
-		0, 0, 0, 0, 0, 1);
-		
-		KF->statePre.at<float>(4) = 0;
-		KF->statePre.at<float>(5) = 0;
-		
-		KF->statePost.at<float>(4) = 0;
-		KF->statePost.at<float>(5) = 0;
+			x = prediction.x;
+			y = prediction.y;
+			missingData ++;
 	}
 	
-	KF->statePre.at<float>(0) = x;
-	KF->statePre.at<float>(1) = y;
-	KF->statePre.at<float>(2) = 0;
-	KF->statePre.at<float>(3) = 0;
-	
-	KF->statePost.at<float>(0) = x;
-	KF->statePost.at<float>(1) = y;
-	KF->statePost.at<float>(2) = 0;
-	KF->statePost.at<float>(3) = 0;
-	
-	setIdentity(KF->measurementMatrix);
-	setIdentity(KF->processNoiseCov, Scalar::all(1e-4));
-	setIdentity(KF->measurementNoiseCov, Scalar::all(1e-1));
-	setIdentity(KF->errorCovPost, Scalar::all(.1));	
+	else if ((x>=0 && y>=0))
+	{		
+		KF.correct(x, y);
+		KF.setPosition(x, y);
+		missingData = 0;
+	}
+	return Point2f(x, y);
 }
 
 
-//////////////////////////////////////////////////////////////////
-// Update of the transition matrix to createmore complex models	
-/////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+// Update the popsition of the corners according to the center position	
+/////////////////////////////////////////////////////////////////////////
 
-void transitionMatrixUpdate (KalmanFilter *KF, float dt)
+Point2f updateCornerPosition(Point2f center, float x, float y, float &deltaX, float &deltaY, int missingData)
 {
-		KF->transitionMatrix = *(Mat_<float>(4, 4) << 
-		1, 0, dt, 0,
-		0, 1, 0, dt,
-		0, 0, 1, 0,
-		0, 0, 0, 1);
+	if(missingData < MAX_MISSING_DATA && (x<0 || y<0))
+	{
+		x = deltaX + center.x;
+		y = deltaY + center.y;
+	}
+	else if ((x>=0 && y>=0))
+	{
+		deltaX = x - center.x;
+		deltaY = y - center.y;
+	}
+	return Point2f(x, y);
 }
 
-void transitionMatrixUpdate (KalmanFilter *KF, float dt,float dv)
-{
-		KF->transitionMatrix = *(Mat_<float>(6, 6) <<
-		1, 0, dt, 0, 0.5*dv, 0,
-		0, 1, 0, dt, 0, 0.5*dv, 
-		0, 0, 1, 0, dv, 0, 
-		0, 0, 0, 1, 0, dv,
-		0, 0, 0, 0, 1, 0,
-		0, 0, 0, 0, 0, 1);
-}
 
-//////////////////////////////////////////
-// Kalman prediction and model update	
-/////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+// Markers of a frame, from the track or from the YAML files when there is no track.
+// The matrices of the track are read-only so they are copied
+/////////////////////////////////////////////////////////////////////////
 
-Mat KalmanModelUpdate (KalmanFilter *KF, float x , float y, int &missingData)
+void readMarkers(MarkerTrackMapping &markersTrack, FileStorage &markersCenter, FileStorage &markersCorners, int frame, Mat &centersMatrix, Mat &cornersMatrix)
 {
-	Mat predictMatrix = KF->predict();
-	
-	if(missingData < MAX_MISSING_DATA && (x<0 || y<0))
+	if (markersTrack.isOpened())
 	{
-			x = predictMatrix.at<float>(0);
-			y = predictMatrix.at<float>(1);
-			missingData ++;
+		markersTrack.getCenters(frame).copyTo(centersMatrix);
+		markersTrack.getCorners(frame).copyTo(cornersMatrix);
+		return;
 	}
 	
-	else if ((x>=0 && y>=0))
-	{		
-		Mat correctMatrix = KF->correct((Mat_<float>(2,1)<<x,y));
-		KF->statePost.at<float>(0) = x;
-		KF->statePost.at<float>(1) = y;
-		missingData = 0;
-	}
-	return (Mat_<float> (1,2) << x, y);
+	stringstream frameNumber;
+	frameNumber << "frame" << frame;
+	markersCenter [frameNumber.str()] >> centersMatrix;
+	markersCorners [frameNumber.str()] >> cornersMatrix;
 }
 
 
 //////////////////////////////////////////////////////////////////////////
-// Update the popsition of the corners according to the center position	
+// Filter the marker i over all the frames, only its column of the
+// matrices is modified so the markers can be filtered in parallel
 /////////////////////////////////////////////////////////////////////////
 
-Mat updateCornerPosition(Mat center, float x, float y, float &deltaX, float &deltaY, int missingData)
+void filterMarker(int i, vector<Mat> &centers, vector<Mat> &corners)
 {
-	if(missingData < MAX_MISSING_DATA && (x<0 || y<0))
-	{
-		x = deltaX + center.at<float>(0);
-		y = deltaY + center.at<float>(1);
-	}
-	else if ((x>=0 && y>=0))
+	int missingData = 0;
+	vector<float> deltaC(8, 0);
+	
+	PositionKalman KF(centers.at(0).at<float>(0,i), centers.at(0).at<float>(1,i), 1);
+	
+	for(int frame = 1; frame < centers.size(); ++frame)
 	{
-		deltaX = x - center.at<float>(0);
-		deltaY = y - center.at<float>(1);
+		Mat &centersMatrix = centers.at(frame);
+		Mat &cornersMatrix = corners.at(frame);
+		
+		KF.setTransition((missingData/5 +1), -1);
+		Point2f updatedCenter = KalmanModelUpdate(KF, centersMatrix.at<float>(0,i), centersMatrix.at<float>(1,i), missingData);
+		centersMatrix.at<float>(0,i) = updatedCenter.x;
+		centersMatrix.at<float>(1,i) = updatedCenter.y;
+		
+		for(int j=0; j<cornersMatrix.rows/2 ; ++j)
+		{
+			Point2f updatedCorner = updateCornerPosition( updatedCenter, cornersMatrix.at<float>((2*j),i), cornersMatrix.at<float>((2*j)+1,i), deltaC.at(2*j), deltaC.at((2*j)+1), missingData);
+			cornersMatrix.at<float>((2*j),i) = updatedCorner.x;
+			cornersMatrix.at<float>((2*j)+1,i) = updatedCorner.y;
+		}
 	}
-	return (Mat_<float> (1,2) << x, y);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Filter all the markers with a pool of threads, each thread takes the
+// next marker that is not filtered yet until there is none left
+/////////////////////////////////////////////////////////////////////////
+
+void filterMarkers(int markerCount, vector<Mat> &centers, vector<Mat> &corners, int threadCount)
+{
+	atomic<int> nextMarker(0);
+	vector<thread> pool;
+	int markerStage = Profiler::stage("marker");
+	for(int t = 0; t < min(threadCount, markerCount); ++t)
+		pool.push_back(thread([&]()
+		{
+			for(int i = nextMarker++; i < markerCount; i = nextMarker++)
+			{
+				ScopedZone zone(markerStage);
+				filterMarker(i, centers, corners);
+			}
+		}));
+	
+	for(int t = 0; t < pool.size(); ++t)
+		pool.at(t).join();
 }
 
 
@@ -161,84 +177,71 @@ Mat updateCornerPosition(Mat center, float x, float y, float &deltaX, float &del
 int main(int argc, char **argv) 
 {
     // Open the datafiles
-    FileStorage markersCenter("markers_centers.yml", FileStorage::READ);
-	FileStorage markersCorners("markers_corners.yml", FileStorage::READ);
-	if(! markersCenter.isOpened() || ! markersCorners.isOpened())
+	MarkerTrackMapping markersTrack;
+	FileStorage markersCenter, markersCorners;
+	if (!markersTrack.open("markers.mkt"))
 	{
-		cerr <<"Error opening data files !" <<endl;
-		return -1;
+		markersCenter.open("markers_centers.yml", FileStorage::READ);
+		markersCorners.open("markers_corners.yml", FileStorage::READ);
+		if(! markersCenter.isOpened() || ! markersCorners.isOpened())
+		{
+			cerr <<"Error opening data files !" <<endl;
+			return -1;
+		}
 	}
 	
-	// Creation of the filtered datafiles
-	FileStorage filteredMarkersCenter("filtered_markers_centers.yml", FileStorage::WRITE);
-	FileStorage filteredMarkersCorners("filtered_markers_corners.yml", FileStorage::WRITE);
+	int threadCount = (argc > 1) ? atoi(argv[1]) : thread::hardware_concurrency();
+	threadCount = max(threadCount, 1);
 	
-	// Creation of the working matrices and other variable
-	Mat centersMatrix, cornersMatrix;
-	int frameCount = (int) markersCenter["frameCount"];
-	stringstream frameNumber;
-	Mat missingData = Mat::zeros(1,10, CV_32S);
-	Mat deltaC = Mat::zeros(8,10, CV_32F);
+	// Load the whole track, the filters need every frame of their marker
+	int frameCount = markersTrack.isOpened() ? markersTrack.getFrameCount() : (int) markersCenter["frameCount"];
+	vector<Mat> centers(frameCount), corners(frameCount);
+	for(int frame = 1; frame <= frameCount ; ++frame)
+	{
+		ScopedZone zone(STAGE_CAPTURE);
+		readMarkers(markersTrack, markersCenter, markersCorners, frame, centers.at(frame-1), corners.at(frame-1));
+	}
 	
+	if (frameCount == 0)
+	{
+		cerr <<"No frame to filter !" <<endl;
+		return -1;
+	}
 	
-	// First lines of the YAML file
+	// Kalman filters (One Kalman per id)
+	int filterStage = Profiler::stage("filter");
+	{
+		ScopedZone zone(filterStage);
+		filterMarkers(centers.at(0).cols, centers, corners, threadCount);
+	}
+	cout << frameCount << " frames of " << centers.at(0).cols << " markers filtered in " << Profiler::totalTime(filterStage)*1e3 << " ms with " << threadCount << " threads" << endl;
+	
+	// Creation of the filtered track, its header contains the ids
 	Mat ids;
-	markersCenter["ids"]>> ids;
-	filteredMarkersCenter << "ids" << ids;
-	filteredMarkersCorners << "ids" << ids;
-	
-	markersCenter ["frame1"] >> centersMatrix;
-	markersCorners ["frame1"] >> cornersMatrix;
-	filteredMarkersCenter << "frame1" << centersMatrix;
-	filteredMarkersCorners << "frame1" << cornersMatrix;
-		
+	if (markersTrack.isOpened())
+		ids = markersTrack.getIds();
+	else
+		markersCenter["ids"]>> ids;
 	
-
-	// Kalman Filters initialization (One Kalman per id)
-
-	vector <KalmanFilter> KFS;
-	for (int i=0; i<centersMatrix.cols; ++i)
+	MarkerTrackWriter filteredMarkers;
+	if (!filteredMarkers.open("filtered_markers.mkt", ids, !markersTrack.isOpened() || markersTrack.hasCorners()))
 	{
-		KalmanFilter KF;
-		initKalman (&KF, centersMatrix.at<float>(0,i), centersMatrix.at<float>(1,i), 1);
-		KFS.push_back(KF);
+		cerr <<"Error creating the filtered track !" <<endl;
+		return -1;
 	}
-
-	// Main loop that goes through all the frames
-	for(int frame = 2; frame <= frameCount ; ++frame)
+	
 	{
-		frameNumber << "frame" << frame;
-		markersCenter [frameNumber.str()] >> centersMatrix;
-		markersCorners [frameNumber.str()] >> cornersMatrix;
-		
-		// Loop that update all the center of the markers
-		for (int i =0; i<centersMatrix.cols; ++i)
-		{
-			transitionMatrixUpdate(&(KFS.at(i)), (missingData.at<int>(i)/5 +1));
-			Mat updatedCenter = KalmanModelUpdate(&(KFS.at(i)), centersMatrix.at<float>(0,i), centersMatrix.at<float>(1,i), missingData.at<int>(i));
-			centersMatrix.at<float>(0,i) = updatedCenter.at<float>(0);
-			centersMatrix.at<float>(1,i) = updatedCenter.at<float>(1);
-			
-			for(int j=0; j<cornersMatrix.rows/2 ; ++j)
-			{
-				Mat updatedCorner = updateCornerPosition( updatedCenter, cornersMatrix.at<float>((2*j),i), cornersMatrix.at<float>((2*j)+1,i), deltaC.at<float>((2*j),i), deltaC.at<float>((2*j)+1,i), missingData.at<int>(i));
-				cornersMatrix.at<float>((2*j),i) = updatedCorner.at<float>(0);
-				cornersMatrix.at<float>((2*j)+1,i) = updatedCorner.at<float>(1);
-			}
-		}
-		
-		filteredMarkersCenter << frameNumber.str() << centersMatrix;
-		filteredMarkersCorners << frameNumber.str() << cornersMatrix;
-		frameNumber.str("");
+		ScopedZone zone(STAGE_OUTPUT);
+		for(int frame = 0; frame < frameCount ; ++frame)
+			filteredMarkers.write(centers.at(frame), corners.at(frame));
+		filteredMarkers.close();
 	}
 	
+	markersTrack.close();
 	markersCenter.release();
 	markersCorners.release();
 	
-	filteredMarkersCenter << "frameCount" << frameCount;
-	filteredMarkersCorners << "frameCount" << frameCount;
-	filteredMarkersCenter.release();
-	filteredMarkersCorners.release();
+	Profiler::summary();
 	
     return 0;
-}
+}
\ No newline at end of file
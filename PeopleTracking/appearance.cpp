@@ -0,0 +1,102 @@
+// Standard libraries
+#include <vector>
+#include <math.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Header
+#include "appearance.h"
+
+
+void patchAppearance(const cv::Mat &region, std::vector<float> &signature)
+{
+	cv::Mat patch;
+	cv::resize(region, patch, cv::Size(PATCH_WIDTH, PATCH_HEIGHT), 0, 0, cv::INTER_AREA);
+	patch.convertTo(patch, CV_32F);
+	patch = patch.reshape(1, 1);
+	signature.assign(patch.ptr<float>(0), patch.ptr<float>(0) + patch.cols);
+
+	double norm = cv::norm(patch);
+	if (norm > 0)
+		for(int k=0; k<signature.size(); ++k)
+			signature.at(k) /= norm;
+}
+
+
+void histogramAppearance(const cv::Mat &region, std::vector<float> &signature)
+{
+	cv::Mat histogram;
+	if (region.channels() == 3)
+	{
+		cv::Mat hsv;
+		cv::cvtColor(region, hsv, CV_BGR2HSV);
+		int channels[] = {0, 1};
+		int bins[] = {HUE_BINS, SATURATION_BINS};
+		float hueRange[] = {0, 180}, saturationRange[] = {0, 256};
+		const float *ranges[] = {hueRange, saturationRange};
+		cv::calcHist(&hsv, 1, channels, cv::Mat(), histogram, 2, bins, ranges);
+	}
+	else
+	{
+		int channels[] = {0};
+		int bins[] = {INTENSITY_BINS};
+		float intensityRange[] = {0, 256};
+		const float *ranges[] = {intensityRange};
+		cv::calcHist(&region, 1, channels, cv::Mat(), histogram, 1, bins, ranges);
+	}
+
+	histogram = histogram.reshape(1, 1);
+	signature.assign(histogram.ptr<float>(0), histogram.ptr<float>(0) + histogram.cols);
+
+	float total = region.total();
+	if (total > 0)
+		for(int k=0; k<signature.size(); ++k)
+			signature.at(k) = sqrt(signature.at(k)/total);
+}
+
+
+void computeAppearance(const cv::Mat &image, cv::Rect target, appearanceType type, std::vector<float> &signature)
+{
+	cv::Mat region(image, target & cv::Rect(0, 0, image.cols, image.rows));
+	if (type == HISTOGRAM_APPEARANCE)
+		histogramAppearance(region, signature);
+	else
+		patchAppearance(region, signature);
+}
+
+
+// Dot product of the two signatures, 0 when they do not have the same length
+float compareAppearance(const std::vector<float> &first, const std::vector<float> &second)
+{
+	if (first.size() != second.size() || first.empty())
+		return 0;
+	return compareAppearance(&first[0], &second[0], first.size());
+}
+
+
+float compareAppearance(const float *first, const float *second, int size)
+{
+	if (first == NULL || second == NULL)
+		return 0;
+
+	int k = 0;
+	const float *a = first, *b = second;
+	float similarity = 0;
+#if defined(__SSE2__)
+	__m128 sum = _mm_setzero_ps();
+	for( ; k+4 <= size; k+=4)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a+k), _mm_loadu_ps(b+k)));
+	float partial[4];
+	_mm_storeu_ps(partial, sum);
+	similarity = partial[0] + partial[1] + partial[2] + partial[3];
+#endif
+	for( ; k < size; ++k)
+		similarity += a[k]*b[k];
+	return similarity;
+}
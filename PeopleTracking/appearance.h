@@ -0,0 +1,31 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+
+// Appearance signature of a target, computed once per frame for each blob and kept by each track.
+// Both signatures are unit vectors, so the similarity of two targets is their dot product, in [0,1]:
+//	PATCH_APPEARANCE : the target downsampled to PATCH_WIDTH x PATCH_HEIGHT, its dot product is the
+//		value of matchTemplate(CV_TM_CCORR_NORMED) on the two resized targets
+//	HISTOGRAM_APPEARANCE : square root of the normalized hue-saturation histogram (intensity histogram
+//		for gray images), its dot product is the Bhattacharyya coefficient of the two histograms
+enum appearanceType
+{
+	PATCH_APPEARANCE,
+	HISTOGRAM_APPEARANCE
+};
+
+int const PATCH_WIDTH = 8;
+int const PATCH_HEIGHT = 16;
+int const HUE_BINS = 16;
+int const SATURATION_BINS = 8;
+int const INTENSITY_BINS = 64;
+
+void computeAppearance(const cv::Mat &image, cv::Rect target, appearanceType type, std::vector<float> &signature);
+float compareAppearance(const std::vector<float> &first, const std::vector<float> &second);
+float compareAppearance(const float *first, const float *second, int size);
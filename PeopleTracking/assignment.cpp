@@ -0,0 +1,166 @@
+// Standard libraries
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+// Header
+#include "assignment.h"
+
+
+// Root of the group of a node, the rows are the nodes 0..rows-1 and the columns the next ones
+int findGroup(std::vector<int> &parent, int node)
+{
+	while (parent.at(node) != node)
+	{
+		parent.at(node) = parent.at(parent.at(node));
+		node = parent.at(node);
+	}
+	return node;
+}
+
+
+// Hungarian algorithm with potentials on a dense n x m matrix (n <= m), O(n^2 m).
+// Gives the column of each row.
+std::vector<int> hungarian(const std::vector<std::vector<double> > &cost)
+{
+	int n = cost.size(), m = cost.at(0).size();
+	double const INF = std::numeric_limits<double>::max();
+
+	// 1-indexed, column 0 is the virtual start of each augmenting path
+	std::vector<double> u(n+1, 0), v(m+1, 0), minSlack(m+1);
+	std::vector<int> match(m+1, 0), way(m+1, 0);
+	std::vector<bool> used(m+1);
+
+	for(int i=1; i<=n; ++i)
+	{
+		match.at(0) = i;
+		int col = 0;
+		std::fill(minSlack.begin(), minSlack.end(), INF);
+		std::fill(used.begin(), used.end(), false);
+		do
+		{
+			used.at(col) = true;
+			int row = match.at(col), nextCol = 0;
+			double delta = INF;
+			for(int j=1; j<=m; ++j)
+				if (!used.at(j))
+				{
+					double slack = cost.at(row-1).at(j-1) - u.at(row) - v.at(j);
+					if (slack < minSlack.at(j))
+					{
+						minSlack.at(j) = slack;
+						way.at(j) = col;
+					}
+					if (minSlack.at(j) < delta)
+					{
+						delta = minSlack.at(j);
+						nextCol = j;
+					}
+				}
+			for(int j=0; j<=m; ++j)
+				if (used.at(j))
+				{
+					u.at(match.at(j)) += delta;
+					v.at(j) -= delta;
+				}
+				else
+					minSlack.at(j) -= delta;
+			col = nextCol;
+		}
+		while (match.at(col) != 0);
+
+		// Flip the augmenting path
+		do
+		{
+			int previous = way.at(col);
+			match.at(col) = match.at(previous);
+			col = previous;
+		}
+		while (col != 0);
+	}
+
+	std::vector<int> assignment(n, -1);
+	for(int j=1; j<=m; ++j)
+		if (match.at(j) != 0)
+			assignment.at(match.at(j)-1) = j-1;
+	return assignment;
+}
+
+
+std::vector<int> solveAssignment(int rows, int cols, const std::vector<assignmentCost> &costs)
+{
+	std::vector<int> assignment(rows, -1);
+
+	// Groups of rows and columns linked by the allowed pairs
+	std::vector<int> parent(rows + cols);
+	for(int i=0; i<parent.size(); ++i)
+		parent.at(i) = i;
+	for(int k=0; k<costs.size(); ++k)
+		parent.at(findGroup(parent, costs.at(k).row)) = findGroup(parent, rows + costs.at(k).col);
+
+	std::vector<std::vector<int> > groupPairs(rows + cols);
+	for(int k=0; k<costs.size(); ++k)
+		groupPairs.at(findGroup(parent, costs.at(k).row)).push_back(k);
+
+	for(int g=0; g<groupPairs.size(); ++g)
+	{
+		const std::vector<int> &pairs = groupPairs.at(g);
+		if (pairs.empty())
+			continue;
+
+		// A single pair needs no solver
+		if (pairs.size() == 1)
+		{
+			assignment.at(costs.at(pairs.at(0)).row) = costs.at(pairs.at(0)).col;
+			continue;
+		}
+
+		// Local indices of the rows and columns of the group
+		std::vector<int> groupRows, groupCols;
+		for(int k=0; k<pairs.size(); ++k)
+		{
+			groupRows.push_back(costs.at(pairs.at(k)).row);
+			groupCols.push_back(costs.at(pairs.at(k)).col);
+		}
+		std::sort(groupRows.begin(), groupRows.end());
+		groupRows.erase(std::unique(groupRows.begin(), groupRows.end()), groupRows.end());
+		std::sort(groupCols.begin(), groupCols.end());
+		groupCols.erase(std::unique(groupCols.begin(), groupCols.end()), groupCols.end());
+
+		// The solver needs at least as many columns as rows
+		bool transposed = groupRows.size() > groupCols.size();
+		int n = transposed ? groupCols.size() : groupRows.size();
+		int m = transposed ? groupRows.size() : groupCols.size();
+
+		// A forbidden pair costs more than all the allowed ones together, so the solver
+		// never trades an assigned row for a cheaper total
+		double forbidden = 1;
+		for(int k=0; k<pairs.size(); ++k)
+			forbidden += std::abs(costs.at(pairs.at(k)).cost);
+		std::vector<std::vector<double> > matrix(n, std::vector<double>(m, forbidden));
+		for(int k=0; k<pairs.size(); ++k)
+		{
+			const assignmentCost &pair = costs.at(pairs.at(k));
+			int r = std::lower_bound(groupRows.begin(), groupRows.end(), pair.row) - groupRows.begin();
+			int c = std::lower_bound(groupCols.begin(), groupCols.end(), pair.col) - groupCols.begin();
+			if (transposed)
+				matrix.at(c).at(r) = std::min(matrix.at(c).at(r), (double) pair.cost);
+			else
+				matrix.at(r).at(c) = std::min(matrix.at(r).at(c), (double) pair.cost);
+		}
+
+		std::vector<int> solution = hungarian(matrix);
+		for(int i=0; i<n; ++i)
+		{
+			int j = solution.at(i);
+			if (j < 0 || matrix.at(i).at(j) >= forbidden)
+				continue;
+			if (transposed)
+				assignment.at(groupRows.at(j)) = groupCols.at(i);
+			else
+				assignment.at(groupRows.at(i)) = groupCols.at(j);
+		}
+	}
+	return assignment;
+}
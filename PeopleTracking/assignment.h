@@ -0,0 +1,21 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+
+
+// Allowed pair of the cost matrix, the pairs that are not given are never assigned
+struct assignmentCost
+{
+	int row;
+	int col;
+	float cost;
+};
+
+
+// Minimum cost assignment of the rows to the columns (each one used at most once) that first
+// assigns as many rows as possible. The rows and columns linked by the pairs are split in
+// independent groups, each group is solved with the Hungarian algorithm, so well separated
+// targets cost a group of one pair each.
+// Gives the column of each row, -1 when the row is not assigned.
+std::vector<int> solveAssignment(int rows, int cols, const std::vector<assignmentCost> &costs);
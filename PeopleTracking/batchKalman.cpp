@@ -0,0 +1,211 @@
+// Standard libraries
+#include <vector>
+#include <algorithm>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Header
+#include "batchKalman.h"
+
+
+// The filter equations are written once for a type holding one track (float) or four tracks (packedFloat)
+template<typename T> T loadValue(const float *p);
+template<typename T> T splat(float value);
+
+template<> inline float loadValue<float>(const float *p) { return *p; }
+template<> inline float splat<float>(float value) { return value; }
+inline void storeValue(float *p, float value) { *p = value; }
+
+#if defined(__SSE2__)
+struct packedFloat
+{
+	__m128 v;
+	packedFloat(__m128 v) : v(v) {}
+};
+
+template<> inline packedFloat loadValue<packedFloat>(const float *p) { return _mm_loadu_ps(p); }
+template<> inline packedFloat splat<packedFloat>(float value) { return _mm_set1_ps(value); }
+inline void storeValue(float *p, packedFloat value) { _mm_storeu_ps(p, value.v); }
+inline packedFloat operator+(packedFloat a, packedFloat b) { return _mm_add_ps(a.v, b.v); }
+inline packedFloat operator-(packedFloat a, packedFloat b) { return _mm_sub_ps(a.v, b.v); }
+inline packedFloat operator*(packedFloat a, packedFloat b) { return _mm_mul_ps(a.v, b.v); }
+inline packedFloat operator/(packedFloat a, packedFloat b) { return _mm_div_ps(a.v, b.v); }
+#endif
+
+
+// x' = F x and P' = F P F^T + Q with F the constant velocity transition, written out term by term
+template<typename T>
+void predictTracks(std::vector<float> *state, std::vector<float> *covariance, int i, float dt, float processNoise)
+{
+	T DT = splat<T>(dt), DT2 = splat<T>(dt*dt), Q = splat<T>(processNoise), TWO = splat<T>(2.f);
+
+	T vx = loadValue<T>(&state[batchKalman::VX][i]);
+	T vy = loadValue<T>(&state[batchKalman::VY][i]);
+	storeValue(&state[batchKalman::X][i], loadValue<T>(&state[batchKalman::X][i]) + DT*vx);
+	storeValue(&state[batchKalman::Y][i], loadValue<T>(&state[batchKalman::Y][i]) + DT*vy);
+
+	T p00 = loadValue<T>(&covariance[batchKalman::P00][i]), p01 = loadValue<T>(&covariance[batchKalman::P01][i]);
+	T p02 = loadValue<T>(&covariance[batchKalman::P02][i]), p03 = loadValue<T>(&covariance[batchKalman::P03][i]);
+	T p11 = loadValue<T>(&covariance[batchKalman::P11][i]), p12 = loadValue<T>(&covariance[batchKalman::P12][i]);
+	T p13 = loadValue<T>(&covariance[batchKalman::P13][i]), p22 = loadValue<T>(&covariance[batchKalman::P22][i]);
+	T p23 = loadValue<T>(&covariance[batchKalman::P23][i]), p33 = loadValue<T>(&covariance[batchKalman::P33][i]);
+
+	storeValue(&covariance[batchKalman::P00][i], p00 + TWO*DT*p02 + DT2*p22 + Q);
+	storeValue(&covariance[batchKalman::P01][i], p01 + DT*(p03 + p12) + DT2*p23);
+	storeValue(&covariance[batchKalman::P02][i], p02 + DT*p22);
+	storeValue(&covariance[batchKalman::P03][i], p03 + DT*p23);
+	storeValue(&covariance[batchKalman::P11][i], p11 + TWO*DT*p13 + DT2*p33 + Q);
+	storeValue(&covariance[batchKalman::P12][i], p12 + DT*p23);
+	storeValue(&covariance[batchKalman::P13][i], p13 + DT*p33);
+	storeValue(&covariance[batchKalman::P22][i], p22 + Q);
+	storeValue(&covariance[batchKalman::P33][i], p33 + Q);
+}
+
+
+// K = P H^T S^-1 with S = H P H^T + R the 2x2 position block, x += K (z - Hx) and P -= K H P.
+// The gain is multiplied by the measured flag so the tracks without measure do not change.
+template<typename T>
+void correctTracks(std::vector<float> *state, std::vector<float> *covariance, const float *measureX, const float *measureY, const float *measured, int i, float measurementNoise)
+{
+	T R = splat<T>(measurementNoise);
+
+	T p00 = loadValue<T>(&covariance[batchKalman::P00][i]), p01 = loadValue<T>(&covariance[batchKalman::P01][i]);
+	T p02 = loadValue<T>(&covariance[batchKalman::P02][i]), p03 = loadValue<T>(&covariance[batchKalman::P03][i]);
+	T p11 = loadValue<T>(&covariance[batchKalman::P11][i]), p12 = loadValue<T>(&covariance[batchKalman::P12][i]);
+	T p13 = loadValue<T>(&covariance[batchKalman::P13][i]), p22 = loadValue<T>(&covariance[batchKalman::P22][i]);
+	T p23 = loadValue<T>(&covariance[batchKalman::P23][i]), p33 = loadValue<T>(&covariance[batchKalman::P33][i]);
+
+	T s00 = p00 + R, s11 = p11 + R;
+	T scale = loadValue<T>(measured + i)/(s00*s11 - p01*p01);
+
+	// Gain, column 0 then column 1 : (P_i0 s11 - P_i1 s01) / det and (P_i1 s00 - P_i0 s01) / det
+	T k00 = (p00*s11 - p01*p01)*scale, k01 = (p01*s00 - p00*p01)*scale;
+	T k10 = (p01*s11 - p11*p01)*scale, k11 = (p11*s00 - p01*p01)*scale;
+	T k20 = (p02*s11 - p12*p01)*scale, k21 = (p12*s00 - p02*p01)*scale;
+	T k30 = (p03*s11 - p13*p01)*scale, k31 = (p13*s00 - p03*p01)*scale;
+
+	T x = loadValue<T>(&state[batchKalman::X][i]), y = loadValue<T>(&state[batchKalman::Y][i]);
+	T innovationX = loadValue<T>(measureX + i) - x;
+	T innovationY = loadValue<T>(measureY + i) - y;
+
+	storeValue(&state[batchKalman::X][i], x + k00*innovationX + k01*innovationY);
+	storeValue(&state[batchKalman::Y][i], y + k10*innovationX + k11*innovationY);
+	storeValue(&state[batchKalman::VX][i], loadValue<T>(&state[batchKalman::VX][i]) + k20*innovationX + k21*innovationY);
+	storeValue(&state[batchKalman::VY][i], loadValue<T>(&state[batchKalman::VY][i]) + k30*innovationX + k31*innovationY);
+
+	// P_ij -= K_i0 P_0j + K_i1 P_1j
+	storeValue(&covariance[batchKalman::P00][i], p00 - k00*p00 - k01*p01);
+	storeValue(&covariance[batchKalman::P01][i], p01 - k00*p01 - k01*p11);
+	storeValue(&covariance[batchKalman::P02][i], p02 - k00*p02 - k01*p12);
+	storeValue(&covariance[batchKalman::P03][i], p03 - k00*p03 - k01*p13);
+	storeValue(&covariance[batchKalman::P11][i], p11 - k10*p01 - k11*p11);
+	storeValue(&covariance[batchKalman::P12][i], p12 - k10*p02 - k11*p12);
+	storeValue(&covariance[batchKalman::P13][i], p13 - k10*p03 - k11*p13);
+	storeValue(&covariance[batchKalman::P22][i], p22 - k20*p02 - k21*p12);
+	storeValue(&covariance[batchKalman::P23][i], p23 - k20*p03 - k21*p13);
+	storeValue(&covariance[batchKalman::P33][i], p33 - k30*p03 - k31*p13);
+}
+
+
+batchKalman::batchKalman(float dt, float processNoise, float measurementNoise, float errorCov)
+{
+	this->dt = dt;
+	this->processNoise = processNoise;
+	this->measurementNoise = measurementNoise;
+	this->errorCov = errorCov;
+}
+
+
+int batchKalman::size() const
+{
+	return (int) measured.size();
+}
+
+
+// New track at rest at (x, y)
+void batchKalman::add(float x, float y)
+{
+	state[X].push_back(x);
+	state[Y].push_back(y);
+	state[VX].push_back(0);
+	state[VY].push_back(0);
+	for(int c=0; c<COVARIANCE_SIZE; ++c)
+		covariance[c].push_back((c == P00 || c == P11 || c == P22 || c == P33) ? errorCov : 0);
+	measureX.push_back(0);
+	measureY.push_back(0);
+	measured.push_back(0);
+}
+
+
+// Track at rest at (x, y) in place of an existing one, the other tracks keep their index
+void batchKalman::reset(int track, float x, float y)
+{
+	state[X].at(track) = x;
+	state[Y].at(track) = y;
+	state[VX].at(track) = 0;
+	state[VY].at(track) = 0;
+	for(int c=0; c<COVARIANCE_SIZE; ++c)
+		covariance[c].at(track) = (c == P00 || c == P11 || c == P22 || c == P33) ? errorCov : 0;
+	measured.at(track) = 0;
+}
+
+
+void batchKalman::clear()
+{
+	for(int s=0; s<STATE_SIZE; ++s)
+		state[s].clear();
+	for(int c=0; c<COVARIANCE_SIZE; ++c)
+		covariance[c].clear();
+	measureX.clear();
+	measureY.clear();
+	measured.clear();
+}
+
+
+void batchKalman::predict()
+{
+	int i = 0, n = size();
+#if defined(__SSE2__)
+	for( ; i+4 <= n; i+=4)
+		predictTracks<packedFloat>(state, covariance, i, dt, processNoise);
+#endif
+	for( ; i < n; ++i)
+		predictTracks<float>(state, covariance, i, dt, processNoise);
+}
+
+
+// Measure of the track for the next correct(), a second measure replaces the first one
+void batchKalman::setMeasure(int track, float x, float y)
+{
+	measureX.at(track) = x;
+	measureY.at(track) = y;
+	measured.at(track) = 1;
+}
+
+
+void batchKalman::correct()
+{
+	int i = 0, n = size();
+	if (n == 0)
+		return;
+#if defined(__SSE2__)
+	for( ; i+4 <= n; i+=4)
+		correctTracks<packedFloat>(state, covariance, &measureX[0], &measureY[0], &measured[0], i, measurementNoise);
+#endif
+	for( ; i < n; ++i)
+		correctTracks<float>(state, covariance, &measureX[0], &measureY[0], &measured[0], i, measurementNoise);
+
+	std::fill(measured.begin(), measured.end(), 0.f);
+}
+
+
+cv::Point2f batchKalman::position(int track) const
+{
+	return cv::Point2f(state[X].at(track), state[Y].at(track));
+}
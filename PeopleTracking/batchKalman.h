@@ -0,0 +1,48 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+
+// Constant velocity Kalman filters (x, y, vx, vy) of all the tracks of a frame, with the same
+// transition and noises as the cv::KalmanFilter of each track they replace.
+// Every value of the state and of the covariance is an array over the tracks (the covariance is
+// symmetric, only its upper triangle is kept), so predict() and correct() run on four tracks at
+// once with SSE2.
+// Like cv::KalmanFilter, predict() gives the prediction as the corrected state, so a track
+// without measure keeps its prediction. The measures of a frame are given with setMeasure()
+// and applied together by correct().
+class batchKalman
+{
+public:
+	enum stateValue { X, Y, VX, VY, STATE_SIZE };
+	enum covarianceValue { P00, P01, P02, P03, P11, P12, P13, P22, P23, P33, COVARIANCE_SIZE };
+
+	batchKalman(float dt = 1, float processNoise = 1e-4f, float measurementNoise = 1e-1f, float errorCov = .1f);
+
+	int size() const;
+	void add(float x, float y);
+	void reset(int track, float x, float y);
+	void clear();
+
+	void predict();
+	void setMeasure(int track, float x, float y);
+	void correct();
+
+	cv::Point2f position(int track) const;
+
+private:
+	float dt;
+	float processNoise;
+	float measurementNoise;
+	float errorCov;
+
+	std::vector<float> state[STATE_SIZE];
+	std::vector<float> covariance[COVARIANCE_SIZE];
+	std::vector<float> measureX, measureY;
+	std::vector<float> measured;		// 1 when the track has a measure for the next correct(), 0 otherwise
+};
@@ -0,0 +1,172 @@
+/*
+ * << mainAppearanceBenchmark >> compares the appearance measures of the tracker on synthetic
+ * people : the former resize + matchTemplate of every pair, and the patch and histogram signatures
+ * of appearance.h computed once per target. It gives the time of one frame and how often the best
+ * match of a target is its own track
+ *
+ */
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+// Others
+#include "appearance.h"
+
+// Namespaces
+using namespace cv;
+using namespace std;
+
+
+// My functions
+void help();
+
+// Global parametres
+int const DEFAULT_PEOPLE = 50;
+int const DEFAULT_FRAMES = 20;
+int const WIDTH = 1920;
+int const HEIGHT = 1080;
+
+
+// People as two-colored boxes (shirt and trousers) in the same frame size as the videos
+void drawPeople(Mat &frame, const vector<Rect> &people, const vector<Scalar> &shirts, const vector<Scalar> &trousers, RNG &rng)
+{
+	frame.create(HEIGHT, WIDTH, CV_8UC3);
+	randu(frame, Scalar::all(60), Scalar::all(90));
+	for(int p=0; p<people.size(); ++p)
+	{
+		Rect top(people.at(p).x, people.at(p).y, people.at(p).width, people.at(p).height/2);
+		Rect bottom(people.at(p).x, people.at(p).y + top.height, people.at(p).width, people.at(p).height - top.height);
+		rectangle(frame, top, shirts.at(p), CV_FILLED);
+		rectangle(frame, bottom, trousers.at(p), CV_FILLED);
+	}
+	Mat noise(frame.size(), CV_8UC3);
+	randn(noise, Scalar::all(0), Scalar::all(8));
+	frame += noise;
+}
+
+
+double elapsedNs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+
+// Former measure of targetTrackingFilter
+float templateSimilarity(const Mat &frame, Rect target, const Mat &model)
+{
+	Mat correlation;
+	double minVal, maxVal;
+	Point minLoc, maxLoc;
+	Mat toCompare = Mat(frame, target);
+	resize(toCompare, toCompare, model.size());
+	matchTemplate(toCompare, model, correlation, CV_TM_CCORR_NORMED);
+	minMaxLoc(correlation, &minVal, &maxVal, &minLoc, &maxLoc);
+	return maxVal;
+}
+
+
+// Main funtion
+int main(int argc, char **argv)
+{
+	if (argc > 1 && string(argv[1]) == "--help")
+	{
+		help();
+		return 0;
+	}
+
+	int people = (argc > 1) ? atoi(argv[1]) : DEFAULT_PEOPLE;
+	int frames = (argc > 2) ? atoi(argv[2]) : DEFAULT_FRAMES;
+
+	RNG rng(12345);
+	vector<Rect> boxes(people);
+	vector<Scalar> shirts(people), trousers(people);
+	for(int p=0; p<people; ++p)
+	{
+		boxes.at(p) = Rect(rng.uniform(0, WIDTH - 80), rng.uniform(0, HEIGHT - 160), rng.uniform(40, 80), rng.uniform(100, 160));
+		shirts.at(p) = Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+		trousers.at(p) = Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+	}
+
+	// Every target is compared with every track, like a crowd that fits in one gate
+	double time[3] = {0, 0, 0};
+	int correct[3] = {0, 0, 0};
+	Mat previous, frame;
+	drawPeople(previous, boxes, shirts, trousers, rng);
+	vector<Rect> previousBoxes = boxes;
+	for(int f=0; f<frames; ++f)
+	{
+		// The people move a little and their blobs change size
+		for(int p=0; p<people; ++p)
+		{
+			boxes.at(p).x = min(max(boxes.at(p).x + rng.uniform(-4, 5), 0), WIDTH - 80);
+			boxes.at(p).y = min(max(boxes.at(p).y + rng.uniform(-4, 5), 0), HEIGHT - 160);
+			boxes.at(p).width = min(max(boxes.at(p).width + rng.uniform(-3, 4), 30), 80);
+			boxes.at(p).height = min(max(boxes.at(p).height + rng.uniform(-3, 4), 90), 160);
+		}
+		drawPeople(frame, boxes, shirts, trousers, rng);
+
+		vector<Mat> models(people);
+		for(int p=0; p<people; ++p)
+			models.at(p) = Mat(previous, previousBoxes.at(p));
+
+		// Former path
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<float> similarities(people*people);
+		for(int i=0; i<people; ++i)
+			for(int j=0; j<people; ++j)
+				similarities.at(i*people + j) = templateSimilarity(frame, boxes.at(i), models.at(j));
+		time[0] += elapsedNs(start);
+		for(int i=0; i<people; ++i)
+			correct[0] += max_element(similarities.begin() + i*people, similarities.begin() + (i+1)*people) - (similarities.begin() + i*people) == i;
+
+		// Signatures, the ones of the tracks were computed when they were matched in the previous frame
+		appearanceType types[2] = {PATCH_APPEARANCE, HISTOGRAM_APPEARANCE};
+		for(int t=0; t<2; ++t)
+		{
+			vector<vector<float> > tracks(people), targets(people);
+			for(int p=0; p<people; ++p)
+				computeAppearance(previous, previousBoxes.at(p), types[t], tracks.at(p));
+
+			start = chrono::steady_clock::now();
+			for(int i=0; i<people; ++i)
+				computeAppearance(frame, boxes.at(i), types[t], targets.at(i));
+			for(int i=0; i<people; ++i)
+				for(int j=0; j<people; ++j)
+					similarities.at(i*people + j) = compareAppearance(targets.at(i), tracks.at(j));
+			time[t+1] += elapsedNs(start);
+			for(int i=0; i<people; ++i)
+				correct[t+1] += max_element(similarities.begin() + i*people, similarities.begin() + (i+1)*people) - (similarities.begin() + i*people) == i;
+		}
+
+		frame.copyTo(previous);
+		previousBoxes = boxes;
+	}
+
+	string names[3] = {"resize + matchTemplate", "Patch signature       ", "Histogram signature   "};
+	cout << frames << " frames of " << people << " people, " << people*people << " pairs per frame" << endl;
+	for(int m=0; m<3; ++m)
+		cout << names[m]
+			 << " -- " << time[m]/frames/1000 << " us/frame"
+			 << " -- Speed-up : " << time[0]/time[m]
+			 << " -- Best match on its own track : " << 100.*correct[m]/(frames*people) << " %" << endl;
+	return 0;
+}
+
+
+
+// Help function
+void help()
+{
+	cout
+	<< "\nUsage: ./program [people] [frames]" << endl
+	<< "Example: ./program 50 20 \n" << endl;
+}
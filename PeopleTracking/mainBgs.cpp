@@ -20,6 +20,7 @@
 // Others
 #include "outputControl.h"
 #include "targetTrackingFilter.h"
+#include "profiler.h"
 #include "Vibe.h"
 
 // Namespaces
@@ -73,7 +74,20 @@ void BgsPostprocess(const cv::Mat &src, cv::Mat &dst)
 // Main funtion
 int main(int argc, char **argv) 
 {
-	if (argc != 2)
+	// Options after the sequence
+	string traceFile;
+	appearanceType appearance = PATCH_APPEARANCE;
+	bool validArguments = argc >= 2;
+	for(int i=2; i<argc; ++i)
+	{
+		if (string(argv[i]) == "--trace" && i+1 < argc)
+			traceFile = argv[++i];
+		else if (string(argv[i]) == "--histogram")
+			appearance = HISTOGRAM_APPEARANCE;
+		else
+			validArguments = false;
+	}
+	if (!validArguments)
 	{
 		help();
 		return 0;
@@ -101,28 +115,47 @@ int main(int argc, char **argv)
 	// Variables initialization
 	Mat frame,frameGray;
 	::BackgroundSubtractor *bgsVibe = new Vibe;
-	targetTrackingFilter trackingFilters;
+	targetTrackingFilter trackingFilters(1, -1, 5, appearance);
 	
 	outputControl control;
 	control.outputControlHelp(1,1,1);
 	
+	int frameStage = profiler::stage("frame");
+	int bgsStage = profiler::stage("background subtraction");
+	int blobsStage = profiler::stage("blobs");
+	if (!traceFile.empty() && !traceRecorder::start(traceFile))
+		cerr << "\nFailed to open the trace file, the timeline is not recorded \n" << endl;
+	traceRecorder::setThreadName("main");
 	
+	int frameNumber = 0;
 	while(true)
 	{
-		// Acquire new frame
-		capture >> frame;
-		
-		cvtColor(frame, frameGray, CV_BGR2GRAY);
+		traceRecorder::setFrame(++frameNumber);
+		traceRecorder::setTracks(trackingFilters.getNumberOfTracks());
+		scopedZone frameZone(frameStage);
 		
+		// Acquire new frame
+		{
+			scopedZone zone(STAGE_CAPTURE);
+			capture >> frame;
+		}
 		
 		// End when video finishes
 		if (frame.empty())
 			break;
 		
-		Mat motion(height,width, CV_8UC1,Scalar::all(225));
+		{
+			scopedZone zone(STAGE_GRAY);
+			cvtColor(frame, frameGray, CV_BGR2GRAY);
+		}
 		
-		Mat bgsMask = bgsVibe->process(frameGray,motion,motion );
-		BgsPostprocess(bgsMask,bgsMask);
+		Mat bgsMask;
+		{
+			scopedZone zone(bgsStage);
+			Mat motion(height,width, CV_8UC1,Scalar::all(225));
+			bgsMask = bgsVibe->process(frameGray,motion,motion );
+			BgsPostprocess(bgsMask,bgsMask);
+		}
 		
 		if (! bgsMask.empty())
 		{
@@ -130,14 +163,21 @@ int main(int argc, char **argv)
 		}
 
 		vector<Rect> blobs;
-		blobsFinder(bgsMask,blobs);		
+		{
+			scopedZone zone(blobsStage);
+			blobsFinder(bgsMask,blobs);
+		}
 		//drawBlobs(frame,blobs);
 		
-		trackingFilters.applyFilter(frame, blobs);
-		trackingFilters.drawTargets(frame);
-		
+		{
+			scopedZone zone(STAGE_TRACKING);
+			trackingFilters.applyFilter(frame, blobs);
+			traceRecorder::setTracks(trackingFilters.getNumberOfTracks());
+		}
 		
 		// Control of the output
+		scopedZone outputZone(STAGE_OUTPUT);
+		trackingFilters.drawTargets(frame);
 		char c = waitKey(1000/fps);
 		control.showVideo("Output", frame, (int) 420, (int) 640 );
 		if(control.quitProgram(c))
@@ -148,6 +188,9 @@ int main(int argc, char **argv)
 		
 	}
 	delete bgsVibe;
+	
+	traceRecorder::stop();
+	profiler::summary();
     return 0;
 }
 
@@ -159,9 +202,11 @@ int main(int argc, char **argv)
 void help()
 {
 	cout
-	<< "\nUsage: ./program <video file or image sequence>" << endl
+	<< "\nUsage: ./program <video file or image sequence> [--trace <trace file>] [--histogram]" << endl
     << "Examples: " << endl
     << "Passing a video file : ./program myvideo.avi" << endl
-    << "Passing an image sequence : ./program image%03d.jpg  (if the images are numbered with 3 digits) \n" << endl;	
+    << "Passing an image sequence : ./program image%03d.jpg  (if the images are numbered with 3 digits)" << endl
+    << "Recording the timeline of the stages : ./program myvideo.avi --trace trace.json  (open it in chrome://tracing or ui.perfetto.dev)" << endl
+    << "Matching the tracks on their color histogram instead of their downsampled patch : ./program myvideo.avi --histogram \n" << endl;	
 }
 
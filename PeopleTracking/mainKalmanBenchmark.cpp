@@ -0,0 +1,148 @@
+/*
+ * << mainKalmanBenchmark >> times the filter stage of targetTrackingFilter for N people : the
+ * batchKalman of all the tracks (structure of arrays, SSE2 across tracks) against one fixed-size
+ * Kalman<4,2> per track, on the same synthetic tracks, and checks that both give the same positions
+ *
+ */
+
+// Standard libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <math.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+// Others
+#include "kalman.h"
+#include "batchKalman.h"
+
+// Namespaces
+using namespace std;
+
+
+// My functions
+void help();
+
+// Global parametres
+int const DEFAULT_TRACKS = 200;
+int const DEFAULT_FRAMES = 2000;
+float const DEFAULT_MISSING = 0.2;
+float const DT = 1.5;		// Same transition as targetTrackingFilter
+
+
+double elapsedNs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+
+// Main funtion
+int main(int argc, char **argv)
+{
+	if (argc > 1 && string(argv[1]) == "--help")
+	{
+		help();
+		return 0;
+	}
+
+	int tracks = (argc > 1) ? atoi(argv[1]) : DEFAULT_TRACKS;
+	int frames = (argc > 2) ? atoi(argv[2]) : DEFAULT_FRAMES;
+	float missing = (argc > 3) ? atof(argv[3]) : DEFAULT_MISSING;
+	if (tracks < 1 || frames < 1)
+	{
+		help();
+		return 0;
+	}
+
+	// People walking in straight lines with noisy detections, NaN when the person is not detected
+	mt19937 rng(12345);
+	uniform_real_distribution<float> uniform(0.f, 1.f);
+	normal_distribution<float> noise(0.f, 1.f);
+	vector<float> measureX(tracks*frames), measureY(tracks*frames);
+	for(int t=0; t<tracks; ++t)
+	{
+		float x = 1920*uniform(rng), y = 1080*uniform(rng);
+		float vx = 4*uniform(rng) - 2, vy = 4*uniform(rng) - 2;
+		for(int f=0; f<frames; ++f)
+		{
+			bool found = uniform(rng) >= missing;
+			measureX.at(f*tracks + t) = found ? x + vx*f + noise(rng) : NAN;
+			measureY.at(f*tracks + t) = found ? y + vy*f + noise(rng) : NAN;
+		}
+	}
+
+	// One filter per track
+	vector<positionKalman> filters;
+	for(int t=0; t<tracks; ++t)
+		filters.push_back(positionKalman(1920*uniform(rng), 1080*uniform(rng), DT));
+	vector<positionKalman> scalarStart = filters;
+
+	// Batch of all the tracks, from the same positions
+	batchKalman batch(DT);
+	for(int t=0; t<tracks; ++t)
+		batch.add(scalarStart.at(t).position().x, scalarStart.at(t).position().y);
+
+	vector<cv::Point2f> scalarPositions(tracks*frames), batchPositions(tracks*frames);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int f=0; f<frames; ++f)
+		for(int t=0; t<tracks; ++t)
+		{
+			positionKalman &KF = filters.at(t);
+			KF.predict();
+			float x = measureX.at(f*tracks + t), y = measureY.at(f*tracks + t);
+			if (x == x)
+				KF.correct(x, y);
+			scalarPositions.at(f*tracks + t) = KF.position();
+		}
+	double scalarTime = elapsedNs(start);
+
+	start = chrono::steady_clock::now();
+	for(int f=0; f<frames; ++f)
+	{
+		batch.predict();
+		for(int t=0; t<tracks; ++t)
+		{
+			float x = measureX.at(f*tracks + t), y = measureY.at(f*tracks + t);
+			if (x == x)
+				batch.setMeasure(t, x, y);
+		}
+		batch.correct();
+		for(int t=0; t<tracks; ++t)
+			batchPositions.at(f*tracks + t) = batch.position(t);
+	}
+	double batchTime = elapsedNs(start);
+
+	float maxDifference = 0;
+	for(int i=0; i<scalarPositions.size(); ++i)
+		maxDifference = max(maxDifference, (float) hypot(scalarPositions.at(i).x - batchPositions.at(i).x, scalarPositions.at(i).y - batchPositions.at(i).y));
+
+	cout << frames << " frames of " << tracks << " tracks, " << missing*100 << "% missing" << endl
+#if defined(__SSE2__)
+		 << "SSE2 batch" << endl
+#else
+		 << "Scalar batch (no SSE2)" << endl
+#endif
+		 << "Kalman<4,2> per track : " << scalarTime/frames/1000 << " us/frame"
+		 << " -- batchKalman : " << batchTime/frames/1000 << " us/frame"
+		 << " -- Speed-up : " << scalarTime/batchTime
+		 << " -- Max difference : " << maxDifference << " px" << endl;
+	return 0;
+}
+
+
+
+// Help function
+void help()
+{
+	cout
+	<< "\nUsage: ./program [tracks] [frames] [missing ratio]" << endl
+	<< "Example: ./program 200 2000 0.2 \n" << endl;
+}
@@ -0,0 +1,51 @@
+// Standard libraries
+#include <vector>
+#include <algorithm>
+
+// Header
+#include "patchPool.h"
+
+
+patchPool::patchPool()
+{
+	size = 0;
+}
+
+
+int patchPool::patchSize() const
+{
+	return size;
+}
+
+
+// The other patches would not be comparable with a signature of another size, it is refused
+bool patchPool::store(int slot, const std::vector<float> &signature)
+{
+	if (signature.empty() || slot < 0)
+		return false;
+	if (size == 0)
+		size = (int) signature.size();
+	else if ((int) signature.size() != size)
+		return false;
+
+	if (arena.size() < (size_t) (slot+1)*size)
+		arena.resize((size_t) (slot+1)*size, 0.f);
+	std::copy(signature.begin(), signature.end(), arena.begin() + (size_t) slot*size);
+	return true;
+}
+
+
+// Patch of the slot, NULL when it was never stored
+const float *patchPool::patch(int slot) const
+{
+	if (size == 0 || slot < 0 || arena.size() < (size_t) (slot+1)*size)
+		return NULL;
+	return &arena[(size_t) slot*size];
+}
+
+
+void patchPool::clear()
+{
+	arena.clear();
+	size = 0;
+}
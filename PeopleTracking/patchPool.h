@@ -0,0 +1,25 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+
+
+// Appearance signatures of the tracks, one fixed-size patch per slot of the tracks in a single arena.
+// The tracks keep no pixel of the frames, so the memory of the tracker is bounded by
+// tracks x patch size, and the patch of a dead track is overwritten when its slot is reused.
+// The size of the patches is taken from the first signature stored after clear(), a signature of
+// another size is refused.
+class patchPool
+{
+public:
+	patchPool();
+
+	int patchSize() const;
+	bool store(int slot, const std::vector<float> &signature);
+	const float *patch(int slot) const;
+	void clear();
+
+private:
+	int size;
+	std::vector<float> arena;
+};
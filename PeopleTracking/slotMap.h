@@ -0,0 +1,78 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+
+
+// Values kept in slots that never move : erase() frees the slot in O(1) and insert() reuses the
+// last freed slot, so the slot of a value can index other arrays (the Kalman filters of the tracks)
+// for as long as the value lives.
+// The generation of a slot changes at each erase, so a handle of an erased value is never taken
+// for the value that reuses its slot.
+template<typename T>
+class slotMap
+{
+public:
+	struct handle
+	{
+		int slot;
+		unsigned int generation;
+	};
+
+	slotMap() : count(0) {}
+
+	// Number of slots, alive or not
+	int capacity() const { return (int) values.size(); }
+	// Number of values
+	int size() const { return count; }
+
+	bool alive(int slot) const { return (generations.at(slot) & 1) != 0; }
+	bool contains(handle h) const { return h.slot >= 0 && h.slot < capacity() && generations.at(h.slot) == h.generation; }
+	handle handleOf(int slot) const { handle h = {slot, generations.at(slot)}; return h; }
+
+	T &at(int slot) { return values.at(slot); }
+	const T &at(int slot) const { return values.at(slot); }
+
+	handle insert(const T &value)
+	{
+		int slot;
+		if (freeSlots.empty())
+		{
+			slot = capacity();
+			values.push_back(value);
+			generations.push_back(0);
+		}
+		else
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+			values.at(slot) = value;
+		}
+		// Odd generations are alive
+		generations.at(slot) ++;
+		count ++;
+		return handleOf(slot);
+	}
+
+	// The value stays in its slot until the slot is reused, so its memory can be reused too
+	void erase(int slot)
+	{
+		if (!alive(slot))
+			return;
+		generations.at(slot) ++;
+		freeSlots.push_back(slot);
+		count --;
+	}
+
+	void clear()
+	{
+		for(int slot=0; slot<capacity(); ++slot)
+			erase(slot);
+	}
+
+private:
+	std::vector<T> values;
+	std::vector<unsigned int> generations;
+	std::vector<int> freeSlots;
+	int count;
+};
@@ -0,0 +1,84 @@
+// Standard libraries
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+// Header
+#include "spatialGrid.h"
+
+
+spatialGrid::spatialGrid(float cellSize)
+{
+	this->cellSize = cellSize;
+	mask = 0;
+	bucketStart.assign(2, 0);
+}
+
+
+void spatialGrid::setCellSize(float cellSize)
+{
+	this->cellSize = cellSize;
+}
+
+
+int spatialGrid::cellCoordinate(float value) const
+{
+	return (int) floor(value/cellSize);
+}
+
+
+unsigned int spatialGrid::bucket(int cellX, int cellY) const
+{
+	return ((unsigned int) cellX*73856093u ^ (unsigned int) cellY*19349663u) & mask;
+}
+
+
+void spatialGrid::build(const std::vector<cv::Point2f> &points)
+{
+	unsigned int buckets = 1;
+	while (buckets < 2*points.size())
+		buckets <<= 1;
+	mask = buckets - 1;
+
+	// Count the points of each bucket, then place them after the points of the previous buckets
+	bucketStart.assign(buckets + 1, 0);
+	pointBucket.resize(points.size());
+	for(int i=0; i<points.size(); ++i)
+	{
+		pointBucket.at(i) = bucket(cellCoordinate(points.at(i).x), cellCoordinate(points.at(i).y));
+		bucketStart.at(pointBucket.at(i) + 1) ++;
+	}
+	for(int b=0; b<buckets; ++b)
+		bucketStart.at(b+1) += bucketStart.at(b);
+
+	entries.resize(points.size());
+	std::vector<int> next(bucketStart.begin(), bucketStart.end() - 1);
+	for(int i=0; i<points.size(); ++i)
+		entries.at(next.at(pointBucket.at(i)) ++) = i;
+}
+
+
+void spatialGrid::neighbours(cv::Point2f p, std::vector<int> &candidates) const
+{
+	candidates.clear();
+	if (entries.empty())
+		return;
+
+	// Two of the nine cells may share a bucket, which is then read once
+	unsigned int visited[9];
+	int visitedCount = 0;
+	int cellX = cellCoordinate(p.x), cellY = cellCoordinate(p.y);
+	for(int dy=-1; dy<=1; ++dy)
+		for(int dx=-1; dx<=1; ++dx)
+		{
+			unsigned int b = bucket(cellX + dx, cellY + dy);
+			if (std::find(visited, visited + visitedCount, b) != visited + visitedCount)
+				continue;
+			visited[visitedCount++] = b;
+			candidates.insert(candidates.end(), entries.begin() + bucketStart.at(b), entries.begin() + bucketStart.at(b+1));
+		}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include "opencv2/core/core.hpp"
+
+
+// Uniform grid over a set of points, rebuilt in O(n) by a counting sort of the points on their cell.
+// The cells are hashed in a table of at least twice as many buckets as points, so the grid
+// has no bounds and its memory only depends on the number of points.
+// With a cell as large as the gate, every point in the gate of p is in the 3x3 cells around p.
+class spatialGrid
+{
+public:
+	spatialGrid(float cellSize = 1);
+
+	void setCellSize(float cellSize);
+	void build(const std::vector<cv::Point2f> &points);
+
+	// Indices of the points in the 3x3 cells around p, they still have to be checked against
+	// the gate since a bucket may hold the points of other cells
+	void neighbours(cv::Point2f p, std::vector<int> &candidates) const;
+
+private:
+	float cellSize;
+	unsigned int mask;
+
+	std::vector<int> bucketStart;		// Points of bucket b are entries[bucketStart[b]..bucketStart[b+1]-1]
+	std::vector<int> entries;
+	std::vector<unsigned int> pointBucket;
+
+	int cellCoordinate(float value) const;
+	unsigned int bucket(int cellX, int cellY) const;
+};
@@ -15,6 +15,7 @@
 
 //Header
 #include "targetTrackingFilter.h"
+#include "assignment.h"
 
 // Global variables
 int MAX_MISSING_DATA;
@@ -22,105 +23,8 @@ int THRESHOLD;
 int BORDERS;
 float CORR_FACTOR;
 
-// Initialization of the Kalman filter	
-void initKalman(cv::KalmanFilter *KF, float x , float y, float dt = 1,float dv = -1)
-{
-	if ( dv<0 )
-	{
-		// KalmanFilter 2D traker with position and constant velocity
-		KF->init(4,2,0);
-		KF->transitionMatrix = *(cv::Mat_<float>(4, 4) << 
-		1, 0, dt, 0,
-		0, 1, 0, dt,
-		0, 0, 1, 0,
-		0, 0, 0, 1);
-	}
-	
-	else
-	{
-		// KalmanFilter 2D traker with position, velocity and constant acceleration
-		KF->init(6,2,0);
-		KF->transitionMatrix = *(cv::Mat_<float>(6, 6) <<
-		1, 0, dt, 0, 0.5*dv, 0,
-		0, 1, 0, dt, 0, 0.5*dv, 
-		0, 0, 1, 0, dv, 0, 
-		0, 0, 0, 1, 0, dv,
-		0, 0, 0, 0, 1, 0,
-		0, 0, 0, 0, 0, 1);
-		
-		KF->statePre.at<float>(4) = 0;
-		KF->statePre.at<float>(5) = 0;
-		
-		KF->statePost.at<float>(4) = 0;
-		KF->statePost.at<float>(5) = 0;
-	}
-	
-	KF->statePre.at<float>(0) = x;
-	KF->statePre.at<float>(1) = y;
-	KF->statePre.at<float>(2) = 0;
-	KF->statePre.at<float>(3) = 0;
-	
-	KF->statePost.at<float>(0) = x;
-	KF->statePost.at<float>(1) = y;
-	KF->statePost.at<float>(2) = 0;
-	KF->statePost.at<float>(3) = 0;
-	
-	cv::setIdentity(KF->measurementMatrix);
-	cv::setIdentity(KF->processNoiseCov, cv::Scalar::all(1e-4));
-	cv::setIdentity(KF->measurementNoiseCov, cv::Scalar::all(1e-1));
-	cv::setIdentity(KF->errorCovPost, cv::Scalar::all(.1));	
-}
-
-
-// Update of the transition matrix to createmore complex models	
-void transitionMatrixUpdate (cv::KalmanFilter *KF, float dt, float dv)
-{
- 	if ( dv<0 )
-	{
-		KF->transitionMatrix = *(cv::Mat_<float>(4, 4) << 
-		1, 0, dt, 0,
-		0, 1, 0, dt,
-		0, 0, 1, 0,
-		0, 0, 0, 1);
-	}
-	
-	else
-	{
-		KF->transitionMatrix = *(cv::Mat_<float>(6, 6) <<
-		1, 0, dt, 0, 0.5*dv, 0,
-		0, 1, 0, dt, 0, 0.5*dv, 
-		0, 0, 1, 0, dv, 0, 
-		0, 0, 0, 1, 0, dv,
-		0, 0, 0, 0, 1, 0,
-		0, 0, 0, 0, 0, 1);
-	}
-}
-
-// Kalman prediction and model update
-
-cv::Mat KalmanModelUpdate (cv::KalmanFilter *KF, float x , float y, int &missingData)
-{
-	cv::Mat predictMatrix = KF->predict();
-	
-	if(missingData < MAX_MISSING_DATA && (x<0 || y<0))
-	{
-			x = predictMatrix.at<float>(0);
-			y = predictMatrix.at<float>(1);
-			missingData ++;
-	}
-	
-	else if ((x>=0 && y>=0))
-	{		
-		cv::Mat correctMatrix = KF->correct((cv::Mat_<float>(2,1)<<x,y));
-		KF->statePost.at<float>(0) = x;
-		KF->statePost.at<float>(1) = y;
-		missingData = 0;
-	}
-	return (cv::Mat_<float> (1,2) << x, y);
-}
 
-
-targetTrackingFilter::targetTrackingFilter(float velocityFactor,float accelerationFactor, int maxMissingData)
+targetTrackingFilter::targetTrackingFilter(float velocityFactor,float accelerationFactor, int maxMissingData, appearanceType appearance) : KFs(1.5)
 {
 	MAX_MISSING_DATA = 18;
 	// MAX_MISSING_DATA down if fps down
@@ -131,6 +35,7 @@ targetTrackingFilter::targetTrackingFilter(float velocityFactor,float accelerati
 	nbOfTargets =0;
 	dt = velocityFactor;
 	dv = accelerationFactor;
+	this->appearance = appearance;
 }
 
 targetTrackingFilter::~targetTrackingFilter(){}
@@ -147,107 +52,139 @@ cv::Point center(cv::Rect square)
 
 void targetTrackingFilter::applyFilter(cv::Mat &image, std::vector<cv::Rect> targets)
 {
+	// Prediction of all the tracks at once, the free slots are predicted too but never gated
+	KFs.predict();
 	predictions.clear();
-	for(int i=0 ; i<KFs.size(); ++i)
+	trackSlots.clear();
+	for(int slot=0 ; slot<tracks.capacity(); ++slot)
+		if (tracks.alive(slot))
+		{
+			predictions.push_back(KFs.position(slot));
+			trackSlots.push_back(slot);
+			tracks.at(slot).missingData ++;
+		}
+	
+	// Signature of each blob, compared with the signature of each gated track
+	observedAppearance.resize(targets.size());
+	for(int i = 0 ; i<targets.size() ; ++i)
+		computeAppearance(image, targets.at(i), appearance, observedAppearance.at(i));
+	
+	// The signatures of frames of another format (number of channels) have another size and cannot be
+	// compared with the patches of the tracks, so the tracking starts again. The filters of the slots
+	// are reset when the slots are reused
+	if (!targets.empty() && appearances.patchSize() != 0 && (int) observedAppearance.at(0).size() != appearances.patchSize())
 	{
-		predictions.push_back(KFs.at(i).predict());
-		missingData.at(i) ++;
+		tracks.clear();
+		appearances.clear();
+		predictions.clear();
+		trackSlots.clear();
 	}
 	
+	// The grid cells are as large as the gate, so a target only looks at the tracks of its 3x3 cells
+	predictionsGrid.setCellSize(THRESHOLD);
+	predictionsGrid.build(predictions);
 	
-	
+	// Gated cost matrix : the appearance of a track is only compared with the targets in the
+	// square THRESHOLD of its prediction, and the pair is allowed when the similarity is above CORR_FACTOR
+	std::vector<assignmentCost> costs;
+	std::vector<bool> close(targets.size(), false);
+	std::vector<int> candidates;
 	for(int i = 0 ; i<targets.size() ; ++i)
 	{
-		bool found = false;
-		bool close = false;
-		for(int j=0 ; j<predictions.size(); ++j)
+		cv::Point targetCenter = center(targets.at(i));
+		predictionsGrid.neighbours(targetCenter, candidates);
+		for(int k=0 ; k<candidates.size(); ++k)
 		{
-			// Check if the observation is in the square THRESHOLD of the track
-			float deltaX = center(targets.at(i)).x-predictions.at(j).at<float>(0);
-			float deltaY = center(targets.at(i)).y-predictions.at(j).at<float>(1);
-			if (abs(deltaX) < THRESHOLD && abs(deltaY) < THRESHOLD)
+			int j = candidates.at(k);
+			float deltaX = targetCenter.x-predictions.at(j).x;
+			float deltaY = targetCenter.y-predictions.at(j).y;
+			if (abs(deltaX) >= THRESHOLD || abs(deltaY) >= THRESHOLD)
+				continue;
+			
+			// Appearance similarity, the signatures are computed once per frame
+			close.at(i) = true;
+			const std::vector<float> &observed = observedAppearance.at(i);
+			float similarity = (!observed.empty() && (int) observed.size() == appearances.patchSize()) ? compareAppearance(&observed[0], appearances.patch(trackSlots.at(j)), observed.size()) : 0;
+			
+			// The appearance comes first, the distance only separates the similar targets
+			if(similarity>CORR_FACTOR)
 			{
-				//correlation
-				close = true;
-				cv::Mat correlation;
-				double minVal, maxVal;
-				cv::Point minLoc, maxLoc;
-				cv::Mat  toCompare = cv::Mat(image,targets.at(i));
-				cv::resize(toCompare,toCompare,targetsModel.at(j).size());
-				cv::matchTemplate(toCompare, targetsModel.at(j), correlation, CV_TM_CCORR_NORMED);
-				cv::minMaxLoc(correlation, &minVal,&maxVal,&minLoc,&maxLoc);
-				std::cout << maxVal << std::endl;
-				
-// 				cv::Mat hist1,hist2;
-// 				cv::calcHist(&cv::Mat(image,targets.at(i)));
-// 				cv::calcHist(&targetsModel.at(j),1,0,cv::Mat(),hist1);
-// 				cv::compareHist();
-				
-				if(maxVal>CORR_FACTOR)
-				{
-					predictions.at(j) = KFs.at(j).correct((cv::Mat_<float>(2,1)<< center(targets.at(i)).x ,center(targets.at(i)).y ));
-					missingData.at(j) = 0;
-					targetsModel.at(j) = cv::Mat(image,targets.at(i));
-					found = true;
-					break;
-				}
+				assignmentCost pair = {i, j, (1 - similarity) + (deltaX*deltaX + deltaY*deltaY)/(2*THRESHOLD*THRESHOLD)};
+				costs.push_back(pair);
 			}
-				
 		}
-		
-		// If no tak is found for the target a new tracking filter is created 
-		if(! found && ! close ) // &&(targets.at(i).x < BORDERS || targets.at(i).x > image.rows - BORDERS || targets.at(i).y < BORDERS || targets.at(i).y > image.cols - BORDERS))
+	}
+	
+	// Each track takes at most one target and each target at most one track
+	std::vector<int> assignment = solveAssignment(targets.size(), predictions.size(), costs);
+	
+	for(int i = 0 ; i<targets.size() ; ++i)
+	{
+		int j = assignment.at(i);
+		if (j >= 0)
 		{
-			cv::KalmanFilter newKalman;
-			initKalman (&newKalman,  center(targets.at(i)).x, center(targets.at(i)).y, 1.5);
-			KFs.push_back(newKalman);
-			missingData.push_back(0);
-			targetsModel.push_back(cv::Mat(image,targets.at(i)));
-			noOfTarget.push_back(++nbOfTargets); 
+			int slot = trackSlots.at(j);
+			peopleTrack &track = tracks.at(slot);
+			KFs.setMeasure(slot, center(targets.at(i)).x ,center(targets.at(i)).y );
+			track.missingData = 0;
+			track.size = targets.at(i).size();
+			appearances.store(slot, observedAppearance.at(i));
 		}
 		
-		// If the track of the target is lost for more than MAX_MISSING_DATA frames the tracking filter is deleted
-		for(int i=0 ; i<missingData.size(); ++i)
-			if(missingData.at(i)>MAX_MISSING_DATA)
-			{
-// 				if(missingData.size() < 2)
-// 				{
-// 					KFs.clear();
-// 					missingData.clear();
-// 					predictions.clear();
-// 					
-// 				}
-// 				else
-				{
-					KFs.erase(KFs.begin()+i);
-					missingData.erase(missingData.begin()+i);
-					predictions.erase(predictions.begin()+i);
-					targetsModel.erase(targetsModel.begin()+i);
-					noOfTarget.erase(noOfTarget.begin()+i);
-				}
-		
-			}
+		// If no track is close to the target a new tracking filter is created in a free slot
+		else if(! close.at(i)) // &&(targets.at(i).x < BORDERS || targets.at(i).x > image.rows - BORDERS || targets.at(i).y < BORDERS || targets.at(i).y > image.cols - BORDERS))
+		{
+			int slot = tracks.insert(peopleTrack()).slot;
+			if (slot == KFs.size())
+				KFs.add(center(targets.at(i)).x, center(targets.at(i)).y);
+			else
+				KFs.reset(slot, center(targets.at(i)).x, center(targets.at(i)).y);
+			
+			peopleTrack &track = tracks.at(slot);
+			track.number = ++nbOfTargets;
+			track.missingData = 0;
+			track.size = targets.at(i).size();
+			appearances.store(slot, observedAppearance.at(i));
+		}
 	}
+	
+	// If the track of the target is lost for more than MAX_MISSING_DATA frames its slot is freed,
+	// its filter is reset when the slot is reused
+	for(int j=0 ; j<trackSlots.size(); ++j)
+		if(tracks.at(trackSlots.at(j)).missingData>MAX_MISSING_DATA)
+			tracks.erase(trackSlots.at(j));
+	
+	// Correction of all the tracks that were found
+	KFs.correct();
 }
 
 
 void targetTrackingFilter::drawTargets(cv::Mat &image,cv::Scalar color, int thickness)
 {
-	for (int i =0; i<KFs.size();++i)
+	for (int slot =0; slot<tracks.capacity();++slot)
 	{
+		if (!tracks.alive(slot))
+			continue;
+		
 		std::stringstream s;
-		s<<noOfTarget.at(i);
+		s<<tracks.at(slot).number;
 		cv::Point label;
-		label.x=KFs.at(i).statePost.at<float>(0);
-		label.y=KFs.at(i).statePost.at<float>(1);
+		label = KFs.position(slot);
 		
 		cv::Rect target;
-		target.width = targetsModel.at(i).cols;
-		target.height = targetsModel.at(i).rows;
-		target.x=KFs.at(i).statePost.at<float>(0)-target.width/2;
-		target.y=KFs.at(i).statePost.at<float>(1)-target.height/2;
+		target.width = tracks.at(slot).size.width;
+		target.height = tracks.at(slot).size.height;
+		target.x=KFs.position(slot).x-target.width/2;
+		target.y=KFs.position(slot).y-target.height/2;
 
 		cv::rectangle(image, target, color , thickness); 
 		cv::putText(image, s.str(), label,CV_FONT_NORMAL, 0.7, color,thickness );
 	}
-}
\ No newline at end of file
+}
+
+
+// Number of targets currently tracked
+int targetTrackingFilter::getNumberOfTracks()
+{
+	return tracks.size();
+}
@@ -8,25 +8,45 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/features2d/features2d.hpp>
 
+// Others
+#include "batchKalman.h"
+#include "spatialGrid.h"
+#include "appearance.h"
+#include "slotMap.h"
+#include "patchPool.h"
+
+
+// Track of one person, its slot is also the index of its Kalman filter and of its appearance patch
+struct peopleTrack
+{
+	int number;
+	int missingData;
+	cv::Size size;		// Size of the last target matched
+};
+
 
 class targetTrackingFilter
 {
 private:
-	std::vector<int> missingData;
-	std::vector<cv::Mat> targetsModel;
-	std::vector<cv::Mat> predictions;
-	std::vector<cv::KalmanFilter> KFs;
-	std::vector<int> noOfTarget;
+	slotMap<peopleTrack> tracks;
+	batchKalman KFs;
+	patchPool appearances;
+	std::vector<std::vector<float> > observedAppearance;
+	std::vector<cv::Point2f> predictions;		// Predictions of the tracks alive, in the order of trackSlots
+	std::vector<int> trackSlots;
+	spatialGrid predictionsGrid;
 	int nbOfTargets;
 	float dt;
 	float dv;
+	appearanceType appearance;
 
 public:
-	targetTrackingFilter (float velocityFactor = 1, float accelerationFactor = -1, int maxMissingData = 5);
+	targetTrackingFilter (float velocityFactor = 1, float accelerationFactor = -1, int maxMissingData = 5, appearanceType appearance = PATCH_APPEARANCE);
 	~targetTrackingFilter();
 	
 	void applyFilter(cv::Mat &image,std::vector<cv::Rect> targets);
 	void drawTargets(cv::Mat &image,cv::Scalar color = CV_RGB(255,0,0), int thickness = 1);
+	int getNumberOfTracks();
 };
 
 
@@ -0,0 +1,264 @@
+// Standard libraries
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+// Header
+#include "traceRecorder.h"
+#include "boundedQueue.h"
+#include "profiler.h"
+
+// Global variables
+int const WRITER_PERIOD_MS = 5;
+
+
+// Ring of one thread, kept until the end of the program like the profiler counters
+struct threadTrace
+{
+	boundedQueue<traceEvent> ring;
+	int id;
+	std::string name;
+
+	threadTrace(int size, int id) : ring(size), id(id) {}
+};
+
+
+struct traceState
+{
+	std::mutex lock;
+	std::vector<threadTrace*> threads;
+	int bufferSize;
+
+	std::atomic<bool> active;
+	std::atomic<bool> writing;
+	std::atomic<uint64_t> dropped;
+	std::chrono::steady_clock::time_point origin;
+
+	std::ofstream file;
+	std::thread writer;
+	bool firstEvent;
+	std::vector<std::string> names;
+
+	traceState() : bufferSize(16384), active(false), writing(false), dropped(0), firstEvent(true) {}
+};
+
+traceState &state()
+{
+	static traceState instance;
+	return instance;
+}
+
+
+// Context of the calling thread
+struct threadContext
+{
+	threadTrace *trace;
+	int frame;
+	int keypoints;
+	int tracks;
+
+	threadContext() : trace(NULL), frame(-1), keypoints(-1), tracks(-1) {}
+};
+
+threadContext &context()
+{
+	static thread_local threadContext instance;
+	return instance;
+}
+
+
+threadTrace &localTrace()
+{
+	threadContext &c = context();
+	if (c.trace == NULL)
+	{
+		traceState &s = state();
+		std::lock_guard<std::mutex> guard(s.lock);
+		c.trace = new threadTrace(s.bufferSize, (int) s.threads.size()+1);
+		s.threads.push_back(c.trace);
+	}
+	return *c.trace;
+}
+
+
+// Write one complete event, times in microseconds
+void writeEvent(traceState &s, const traceEvent &event)
+{
+	if (event.stage >= (int) s.names.size())
+		for(int i = s.names.size(); i <= event.stage; ++i)
+			s.names.push_back(profiler::stageName(i));
+
+	s.file << (s.firstEvent ? "" : ",\n")
+		   << "{\"name\":\"" << (event.stage >= 0 ? s.names.at(event.stage) : "unknown") << "\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1"
+		   << ",\"tid\":" << event.thread
+		   << ",\"ts\":" << event.begin*1e-3
+		   << ",\"dur\":" << (event.end - event.begin)*1e-3
+		   << ",\"args\":{";
+	s.firstEvent = false;
+
+	bool first = true;
+	if (event.frame >= 0)
+	{
+		s.file << "\"frame\":" << event.frame;
+		first = false;
+	}
+	if (event.keypoints >= 0)
+	{
+		s.file << (first ? "" : ",") << "\"keypoints\":" << event.keypoints;
+		first = false;
+	}
+	if (event.tracks >= 0)
+		s.file << (first ? "" : ",") << "\"tracks\":" << event.tracks;
+	s.file << "}}";
+}
+
+
+// Empty every ring into the file, only called by the writer thread
+void drain(traceState &s, bool write)
+{
+	std::vector<threadTrace*> threads;
+	{
+		std::lock_guard<std::mutex> guard(s.lock);
+		threads = s.threads;
+	}
+
+	traceEvent event;
+	for(int t = 0; t < threads.size(); ++t)
+		while (threads.at(t)->ring.tryPop(event))
+			if (write)
+				writeEvent(s, event);
+}
+
+
+void writerLoop()
+{
+	traceState &s = state();
+	while (s.writing.load(std::memory_order_acquire))
+	{
+		drain(s, true);
+		std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_PERIOD_MS));
+	}
+	drain(s, true);
+}
+
+
+// Open the trace file and start the writer, bufferSize is the number of events of each ring
+bool traceRecorder::start(const std::string &filename, int bufferSize)
+{
+	traceState &s = state();
+	if (s.writing)
+		return false;
+
+	s.file.open(filename.c_str());
+	if (!s.file.is_open())
+		return false;
+	s.file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+
+	{
+		std::lock_guard<std::mutex> guard(s.lock);
+		s.bufferSize = bufferSize;
+	}
+
+	// Events left by a previous trace are dropped
+	drain(s, false);
+
+	s.firstEvent = true;
+	s.names.clear();
+	s.dropped = 0;
+	s.origin = std::chrono::steady_clock::now();
+	s.writing = true;
+	s.writer = std::thread(writerLoop);
+	s.active.store(true, std::memory_order_release);
+	return true;
+}
+
+
+// Write the events still in the rings and close the file
+void traceRecorder::stop()
+{
+	traceState &s = state();
+	if (!s.writing)
+		return;
+
+	s.active.store(false, std::memory_order_release);
+	s.writing.store(false, std::memory_order_release);
+	s.writer.join();
+
+	// Names of the threads
+	std::lock_guard<std::mutex> guard(s.lock);
+	for(int t = 0; t < s.threads.size(); ++t)
+		if (!s.threads.at(t)->name.empty())
+		{
+			s.file << (s.firstEvent ? "" : ",\n")
+				   << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << s.threads.at(t)->id
+				   << ",\"args\":{\"name\":\"" << s.threads.at(t)->name << "\"}}";
+			s.firstEvent = false;
+		}
+
+	s.file << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << s.dropped.load() << "}}" << std::endl;
+	s.file.close();
+}
+
+
+bool traceRecorder::enabled()
+{
+	return state().active.load(std::memory_order_relaxed);
+}
+
+
+void traceRecorder::record(int stage, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+	traceState &s = state();
+	if (!s.active.load(std::memory_order_acquire))
+		return;
+
+	threadContext &c = context();
+	threadTrace &trace = localTrace();
+
+	traceEvent event;
+	event.stage = stage;
+	event.thread = trace.id;
+	event.frame = c.frame;
+	event.keypoints = c.keypoints;
+	event.tracks = c.tracks;
+	event.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - s.origin).count();
+	event.end = std::chrono::duration_cast<std::chrono::nanoseconds>(end - s.origin).count();
+
+	if (!trace.ring.tryPush(event))
+		s.dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void traceRecorder::setThreadName(const std::string &name)
+{
+	threadTrace &trace = localTrace();
+	std::lock_guard<std::mutex> guard(state().lock);
+	trace.name = name;
+}
+
+
+// Context attached to the next events of the calling thread, -1 leaves it out
+// A new frame clears the keypoints and the tracks of the previous one
+void traceRecorder::setFrame(int frame)
+{
+	threadContext &c = context();
+	c.frame = frame;
+	c.keypoints = -1;
+	c.tracks = -1;
+}
+
+void traceRecorder::setKeypoints(int keypoints)
+{
+	context().keypoints = keypoints;
+}
+
+void traceRecorder::setTracks(int tracks)
+{
+	context().tracks = tracks;
+}